@@ -0,0 +1,100 @@
+// 时间戳解析微基准：对比原 istringstream 实现与 timestampParser.cpp 中的无分配解析器
+// 用法：bench/timestampBench [输入文件...]（默认使用 input1.txt）
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../timestampParser.cpp"
+
+using namespace std;
+
+// 原 hotWord::Timestamp 实现（substr + istringstream），作为基准
+long long LegacyTimestamp(const string &timeStr)
+{
+    if (timeStr.length() < 3 || timeStr[0] != '[' || timeStr[timeStr.length() - 1] != ']')
+    {
+        return -1;
+    }
+    string clean = timeStr.substr(1, timeStr.length() - 2);
+    istringstream iss(clean);
+    int hours = 0, minutes = 0, seconds = 0;
+    char colon1, colon2;
+    if (!(iss >> hours >> colon1 >> minutes >> colon2 >> seconds))
+    {
+        return -1;
+    }
+    if (colon1 != ':' || colon2 != ':')
+    {
+        return -1;
+    }
+    return hours * 3600 + minutes * 60 + seconds;
+}
+
+template<typename Parser>
+double Measure(const vector<string> &stamps, int rounds, Parser parse, long long &checksum)
+{
+    checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (size_t i = 0; i < stamps.size(); i++)
+        {
+            checksum += parse(stamps[i]);
+        }
+    }
+    auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    return (double)elapsed / ((double)rounds * stamps.size());
+}
+
+int main(int argc, char *argv[])
+{
+    vector<string> files;
+    for (int i = 1; i < argc; i++)    files.push_back(argv[i]);
+    if (files.empty())    files.push_back("input1.txt");
+
+    // 收集输入文件中每一行的时间戳部分
+    vector<string> stamps;
+    for (size_t f = 0; f < files.size(); f++)
+    {
+        ifstream ifs(files[f], ios::binary);
+        string line;
+        while (getline(ifs, line))
+        {
+            size_t pos = line.find(']');
+            if (pos != string::npos && line.find("ACTION") == string::npos)
+            {
+                stamps.push_back(line.substr(0, pos + 1));
+            }
+        }
+    }
+    if (stamps.empty())
+    {
+        cerr << "没有读到时间戳，请检查输入文件。" << endl;
+        return 1;
+    }
+
+    // 正确性：两种实现在 [H:MM:SS] 上结果必须一致
+    for (size_t i = 0; i < stamps.size(); i++)
+    {
+        if (LegacyTimestamp(stamps[i]) != ParseTimestamp(stamps[i].data(), stamps[i].size()))
+        {
+            cerr << "结果不一致: " << stamps[i] << endl;
+            return 1;
+        }
+    }
+
+    const int rounds = (int)(2000000 / stamps.size()) + 1;
+    long long legacySum, fastSum;
+    double legacyNs = Measure(stamps, rounds, [](const string &s) { return LegacyTimestamp(s); }, legacySum);
+    double fastNs = Measure(stamps, rounds, [](const string &s) { return ParseTimestamp(s.data(), s.size()); }, fastSum);
+
+    cout << "时间戳数量: " << stamps.size() << " x " << rounds << " 轮" << endl;
+    cout << "istringstream 实现: " << legacyNs << " ns/次" << endl;
+    cout << "ParseTimestamp:     " << fastNs << " ns/次" << endl;
+    cout << "加速比: " << legacyNs / fastNs << "x" << endl;
+    cout << "校验和: " << legacySum << " / " << fastSum << endl;
+    return 0;
+}
@@ -0,0 +1,83 @@
+// 词典 Trie 后端基准：比较 hash Trie 与双数组 Trie 的 MPSegment::Cut 吞吐量和常驻内存
+// 用法：bench/trieBench <hash|double_array> <词典路径> [输入文件...]
+// 每个后端需单独运行一次进程，这样常驻内存（VmRSS）互不干扰。
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cppjieba/MPSegment.hpp"
+
+using namespace std;
+using namespace cppjieba;
+
+// 读取当前进程的常驻内存（KB），非 Linux 平台返回 0
+long ReadRssKb()
+{
+    ifstream ifs("/proc/self/status");
+    string line;
+    while (getline(ifs, line))
+    {
+        if (line.compare(0, 6, "VmRSS:") == 0)    return atol(line.c_str() + 6);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        cerr << "用法: " << argv[0] << " <hash|double_array> <词典路径> [输入文件...]" << endl;
+        return 1;
+    }
+    string backendName = argv[1];
+    DictTrie::TrieBackend backend = backendName == "double_array"
+        ? DictTrie::DoubleArrayTrieBackend : DictTrie::HashTrieBackend;
+    vector<string> files;
+    for (int i = 3; i < argc; i++)    files.push_back(argv[i]);
+    if (files.empty())    files.push_back("input1.txt");
+
+    // 收集句子内容（去掉时间戳和 ACTION 行）
+    vector<string> sentences;
+    size_t totalBytes = 0;
+    for (size_t f = 0; f < files.size(); f++)
+    {
+        ifstream ifs(files[f], ios::binary);
+        string line;
+        while (getline(ifs, line))
+        {
+            if (line.find("ACTION") != string::npos)    continue;
+            size_t pos = line.find(']');
+            sentences.push_back(pos == string::npos ? line : line.substr(pos + 1));
+            totalBytes += sentences.back().size();
+        }
+    }
+
+    long rssBefore = ReadRssKb();
+    auto loadStart = chrono::steady_clock::now();
+    DictTrie dictTrie(argv[2], "", DictTrie::WordWeightMedian, backend);
+    double loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count();
+    long rssAfter = ReadRssKb();
+
+    MPSegment segment(&dictTrie);
+    vector<string> words;
+    size_t wordCount = 0;
+    const int rounds = 20;
+    auto cutStart = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (size_t i = 0; i < sentences.size(); i++)
+        {
+            segment.Cut(sentences[i], words);
+            wordCount += words.size();
+        }
+    }
+    double cutSec = chrono::duration<double>(chrono::steady_clock::now() - cutStart).count();
+
+    cout << "后端: " << backendName << endl;
+    cout << "词典加载: " << loadMs << " ms，常驻内存增加 " << (rssAfter - rssBefore) / 1024.0 << " MB" << endl;
+    cout << "MPSegment::Cut: " << sentences.size() * rounds / cutSec << " 句/秒，"
+         << totalBytes * rounds / cutSec / (1024 * 1024) << " MB/秒（" << wordCount << " 个词）" << endl;
+    return 0;
+}
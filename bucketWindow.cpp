@@ -0,0 +1,470 @@
+#ifndef BUCKET_WINDOW_CPP
+#define BUCKET_WINDOW_CPP
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * 分桶滑动窗口
+ * 按到达顺序把出现记录聚合到环形数组中的桶里：时间戳落在同一粒度（bucketSeconds）内的连续出现
+ * 共用一个桶，桶内保存 (词编号, 次数) 对。内存随每个桶内的不同词数增长，而不是随原始词条数增长；
+ * 过期时整桶丢弃，代价为 O(桶内不同词数)
+ *
+ * 与逐条队列相同，过期从最早到达的桶开始，遇到未过期的桶即停止；桶以其中最晚的时间戳判断过期，
+ * 因此 bucketSeconds > 1 时桶内较早的词最多多保留 bucketSeconds - 1 秒，
+ * bucketSeconds = 1 时与逐条队列的语义完全一致（包括乱序输入）
+ *
+ * 多个窗口长度共用同一组桶：每个窗口有自己的过期游标，桶在最长的窗口也越过它时才释放
+ * 新的出现先记在待提交列表中（按词合并），只在查询前或某个窗口即将过期尚未提交的桶时
+ * 才一次性提交给所有窗口，因此每次出现只记录一次，各窗口只按 (词, 合并次数) 更新
+ * 每次提交是一个批次：提交后最后一个桶不再接收新的出现，每个桶内的出现都属于同一批次，
+ * 过期时把桶的批次连同 (词, 次数) 交给计数器，计数器可以据此区分某个时刻之前计入的出现（见 spaceSavingCounter）
+ *
+ * 迟到修正（addLate）：只要出现都经 addLate 记录，桶就按时间排列；迟到的出现直接并入其时间所在的桶
+ * （没有时插入一个），立即计入仍包含该桶的窗口，过期时随桶一起移出，因此不需要重排序缓冲区
+ *
+ * 窗口长度可以在线调整（resize）：缩小时立即过期；放大时游标向回移动，把仍保留的历史桶重新计入，
+ * 每次调用最多重新计入约 restoreBudget 个 (词, 次数) 对，剩余部分在之后的 advance 中继续。
+ * 桶至少保留 retention 秒（保留期），因此窗口最多可以从历史中恢复到 retention 秒
+ */
+class bucketWindow
+{
+private:
+    struct bucket
+    {
+        long long index = 0;                 // 粒度编号 floor(timestamp / bucketSeconds)
+        long long latest = 0;                // 桶内最晚的时间戳
+        unsigned long long batch = 0;        // 桶内的出现所属的提交批次
+        vector<pair<uint32_t, int>> counts;  // (词编号, 次数)
+    };
+
+    vector<long long> windowSizes;
+    long long bucketSeconds;
+    vector<bucket> ring;          // 序号为 serial 的桶位于 ring[serial % ring.size()]，弹出的桶保留容量供复用
+    unsigned long long head = 0;  // 最早的桶的序号
+    unsigned long long tail = 0;  // 下一个新桶的序号
+    vector<unsigned long long> cursor; // 每个窗口中最早的桶的序号
+    vector<char> growing;              // 窗口放大后还在向回恢复历史桶
+
+    long long retention;                    // 保留期（秒）
+    unsigned long long retentionCursor = 0; // 保留期内最早的桶的序号
+    size_t restoreBudget;                   // 每次调用最多重新计入的 (词, 次数) 对数
+    long long lastNow = 0;
+    bool hasNow = false;
+
+    // 每个词最近一次写入的桶（序号 + 1，0 表示从未写入）及其在 counts 中的位置，同一桶内的重复词 O(1) 合并
+    vector<unsigned long long> lastSerial;
+    vector<uint32_t> lastPos;
+
+    // 尚未提交给各窗口的出现：(词编号, 次数)，以及它们所在的最早的桶
+    vector<pair<uint32_t, int>> pending;
+    vector<unsigned long long> pendingTag; // 词在 pending 中时为 flushCount + 1
+    vector<uint32_t> pendingPos;
+    unsigned long long flushCount = 0;
+    unsigned long long pendingFrom = 0;
+
+    long long bucketOf(long long timestamp) const
+    {
+        // 向下取整，兼容负时间戳
+        return timestamp >= 0 ? timestamp / bucketSeconds : -((-timestamp + bucketSeconds - 1) / bucketSeconds);
+    }
+
+    bucket &at(unsigned long long serial)
+    {
+        return ring[(size_t)(serial % ring.size())];
+    }
+
+    // 在环尾开一个新桶，环满时按两倍扩容（乱序输入时桶数可能超过窗口跨度）
+    bucket &pushBucket(long long index, long long timestamp)
+    {
+        if (tail - head == ring.size())
+        {
+            vector<bucket> grown(ring.size() * 2);
+            for (unsigned long long s = head; s < tail; s++)
+            {
+                bucket &to = grown[(size_t)(s % grown.size())];
+                bucket &from = at(s);
+                to.index = from.index;
+                to.latest = from.latest;
+                to.batch = from.batch;
+                to.counts.swap(from.counts);
+            }
+            ring.swap(grown);
+        }
+        bucket &b = at(tail++);
+        b.index = index;
+        b.latest = timestamp;
+        b.batch = flushCount;
+        b.counts.clear();
+        return b;
+    }
+
+    // 在序号 p 处插入一个新桶（p 之后的桶后移一位），游标按新桶是否在各窗口 / 保留期内调整
+    bucket &insertBucket(unsigned long long p, long long index, long long timestamp)
+    {
+        pushBucket(index, timestamp);
+        for (unsigned long long s = tail - 1; s > p; s--)
+        {
+            bucket &to = at(s), &from = at(s - 1);
+            swap(to.index, from.index);
+            swap(to.latest, from.latest);
+            swap(to.batch, from.batch);
+            to.counts.swap(from.counts);
+        }
+        bucket &b = at(p);
+        b.index = index;
+        b.latest = timestamp;
+        b.batch = flushCount;
+        b.counts.clear();
+
+        for (size_t w = 0; w < cursor.size(); w++)
+        {
+            if (cursor[w] > p || (cursor[w] == p && lastNow - timestamp > windowSizes[w]))    cursor[w]++;
+        }
+        if (retentionCursor > p || (retentionCursor == p && lastNow - timestamp > retention))    retentionCursor++;
+        if (!pending.empty() && pendingFrom >= p)    pendingFrom++;
+        // 原来最后一个桶后移了一位，其中的词继续按序号合并
+        for (uint32_t i = 0; i < at(tail - 1).counts.size(); i++)    lastSerial[at(tail - 1).counts[i].first] = tail;
+        return b;
+    }
+
+public:
+    /**
+     * @param windowSizes 各窗口长度（秒），下标即窗口编号
+     * @param retention 保留期（秒），小于最长的窗口时取最长的窗口
+     */
+    bucketWindow(const vector<long long> &windowSizes, long long bucketSeconds = 1,
+                 long long retention = 0, size_t restoreBudget = 100000)
+        : windowSizes(windowSizes), bucketSeconds(bucketSeconds > 0 ? bucketSeconds : 1),
+        cursor(windowSizes.size(), 0), growing(windowSizes.size(), 0),
+        restoreBudget(restoreBudget > 0 ? restoreBudget : 1)
+    {
+        long long longest = windowSizes.empty() ? 0 : *max_element(windowSizes.begin(), windowSizes.end());
+        this->retention = max(retention, longest);
+        // 顺序输入时保留期内约有 retention / bucketSeconds + 1 个桶
+        ring.resize((size_t)(this->retention / this->bucketSeconds + 2));
+    }
+
+    long long windowSize(size_t w) const
+    {
+        return windowSizes[w];
+    }
+
+    long long retentionSeconds() const
+    {
+        return retention;
+    }
+
+    /**
+     * 调整窗口 w 的长度：缩小时立即过期，放大时开始恢复保留期内的历史桶，对每个 (词编号, 次数) 调用 restore(窗口编号, 词编号, 次数, 批次)
+     * 参数含义同 advance，以最近一次 advance 的时间为当前时间
+     */
+    template <class Submit, class Evict, class Restore>
+    void resize(size_t w, long long size, Submit &&submit, Evict &&evict, Restore &&restore)
+    {
+        growing[w] = size > windowSizes[w];
+        windowSizes[w] = size;
+        if (hasNow)    advance(lastNow, submit, evict, restore);
+    }
+
+    // 记录一次出现
+    void add(uint32_t id, long long timestamp)
+    {
+        long long index = bucketOf(timestamp);
+        bucket *b;
+        if (tail != head && at(tail - 1).index == index && at(tail - 1).batch == flushCount)
+        {
+            b = &at(tail - 1);
+            if (timestamp > b->latest)    b->latest = timestamp;
+        }
+        else
+        {
+            b = &pushBucket(index, timestamp);
+        }
+
+        if (id >= lastSerial.size())
+        {
+            lastSerial.resize(id + 1, 0);
+            lastPos.resize(id + 1, 0);
+            pendingTag.resize(id + 1, 0);
+            pendingPos.resize(id + 1, 0);
+        }
+        if (lastSerial[id] == tail)
+        {
+            b->counts[lastPos[id]].second++;
+        }
+        else
+        {
+            lastSerial[id] = tail;
+            lastPos[id] = (uint32_t)b->counts.size();
+            b->counts.push_back(make_pair(id, 1));
+        }
+
+        if (pending.empty())    pendingFrom = tail - 1;
+        if (pendingTag[id] == flushCount + 1)
+        {
+            pending[pendingPos[id]].second++;
+        }
+        else
+        {
+            pendingTag[id] = flushCount + 1;
+            pendingPos[id] = (uint32_t)pending.size();
+            pending.push_back(make_pair(id, 1));
+        }
+    }
+
+    // 时间戳是否早于最后一个桶（需经 addLate 记录）
+    bool isLate(long long timestamp) const
+    {
+        return tail != head && bucketOf(timestamp) < ring[(size_t)((tail - 1) % ring.size())].index;
+    }
+
+    /**
+     * 记录一次迟到的出现：并入其时间所在的桶（没有时按时间顺序插入一个），
+     * 对仍包含该桶的每个窗口立即调用 submit(窗口编号, 词编号, 1, 桶的批次)；二分查找 O(log 桶数)，插入新桶时 O(其后的桶数)
+     * @return false 如果该桶已不在任何窗口内（早于所有窗口的出现被丢弃）
+     */
+    template <class Submit>
+    bool addLate(uint32_t id, long long timestamp, Submit &&submit)
+    {
+        long long index = bucketOf(timestamp);
+        // 第一个 index 不小于目标的桶
+        unsigned long long lo = head, hi = tail;
+        while (lo < hi)
+        {
+            unsigned long long mid = lo + (hi - lo) / 2;
+            if (at(mid).index < index)    lo = mid + 1;
+            else    hi = mid;
+        }
+        unsigned long long oldest = cursor.empty() ? tail : *min_element(cursor.begin(), cursor.end());
+        if (lo < oldest || (lo == oldest && at(lo).index != index && lastNow - timestamp > *max_element(windowSizes.begin(), windowSizes.end())))
+        {
+            return false;
+        }
+
+        bucket *b;
+        if (at(lo).index == index)
+        {
+            b = &at(lo);
+            if (timestamp > b->latest)    b->latest = timestamp;
+        }
+        else
+        {
+            if (id >= lastSerial.size())
+            {
+                lastSerial.resize(id + 1, 0);
+                lastPos.resize(id + 1, 0);
+                pendingTag.resize(id + 1, 0);
+                pendingPos.resize(id + 1, 0);
+            }
+            b = &insertBucket(lo, index, timestamp);
+        }
+        if (!b->counts.empty() && b->counts.back().first == id)    b->counts.back().second++;
+        else    b->counts.push_back(make_pair(id, 1));
+
+        bool counted = false;
+        for (size_t w = 0; w < cursor.size(); w++)
+        {
+            if (cursor[w] > lo)    continue;
+            submit(w, id, 1, b->batch);
+            counted = true;
+        }
+        return counted;
+    }
+
+    /**
+     * 把待提交的出现交给 submit(词编号, 次数, 批次)，调用方对每个窗口的计数器加上该次数
+     */
+    template <class Submit>
+    void flush(Submit &&submit)
+    {
+        if (pending.empty())    return;
+        for (const auto &entry : pending)    submit(entry.first, entry.second, flushCount);
+        pending.clear();
+        flushCount++;
+    }
+
+    /**
+     * 以 now 为当前时间，对每个窗口从最早的桶开始过期，对其中每个 (词编号, 次数) 调用 evict(窗口编号, 词编号, 次数, 批次)
+     * 要过期的桶还有未提交的出现时先调用 flush(submit)；正在放大的窗口先继续恢复历史桶，见 resize
+     */
+    template <class Submit, class Evict, class Restore>
+    void advance(long long now, Submit &&submit, Evict &&evict, Restore &&restore)
+    {
+        lastNow = now;
+        hasNow = true;
+        size_t budget = restoreBudget;
+        for (size_t w = 0; w < windowSizes.size(); w++)
+        {
+            // 游标之前的桶都已提交过，可以直接重新计入
+            while (growing[w] && budget > 0 && cursor[w] > head && now - at(cursor[w] - 1).latest <= windowSizes[w])
+            {
+                const bucket &b = at(--cursor[w]);
+                for (const auto &entry : b.counts)    restore(w, entry.first, entry.second, b.batch);
+                budget -= min(budget, max(b.counts.size(), (size_t)1));
+            }
+            if (growing[w] && (cursor[w] == head || now - at(cursor[w] - 1).latest > windowSizes[w]))    growing[w] = 0;
+
+            while (cursor[w] != tail && now - at(cursor[w]).latest > windowSizes[w])
+            {
+                if (!pending.empty() && cursor[w] >= pendingFrom)    flush(submit);
+                const bucket &b = at(cursor[w]);
+                for (const auto &entry : b.counts)    evict(w, entry.first, entry.second, b.batch);
+                cursor[w]++;
+            }
+        }
+        // 保留期和所有窗口都越过的桶可以释放
+        while (retentionCursor != tail && now - at(retentionCursor).latest > retention)    retentionCursor++;
+        unsigned long long oldest = retentionCursor;
+        for (unsigned long long c : cursor)    oldest = min(oldest, c);
+        while (head < oldest)    at(head++).counts.clear();
+    }
+
+    /**
+     * 保存到检查点：窗口长度、游标、保留的桶和待提交列表
+     * 待提交列表原样保存而不是先 flush，写检查点不改变之后提交给计数器的批次
+     */
+    template <class Writer>
+    void save(Writer &writer) const
+    {
+        writer.putVector(windowSizes);
+        writer.put(bucketSeconds);
+        writer.put(retention);
+        writer.put(lastNow);
+        writer.put(hasNow);
+        writer.put((uint64_t)(tail - head));
+        for (unsigned long long s = head; s < tail; s++)
+        {
+            const bucket &b = ring[(size_t)(s % ring.size())];
+            writer.put(b.index);
+            writer.put(b.latest);
+            writer.put(b.batch);
+            writer.putVector(b.counts);
+        }
+        for (size_t w = 0; w < cursor.size(); w++)
+        {
+            writer.put((uint64_t)(cursor[w] - head));
+            writer.put(growing[w]);
+        }
+        writer.put((uint64_t)(retentionCursor - head));
+        writer.put(flushCount);
+        writer.putVector(pending);
+        writer.put((uint64_t)(pending.empty() ? 0 : pendingFrom - head));
+    }
+
+    /**
+     * 从检查点恢复（窗口数和分桶粒度必须与构造时相同），之后用 replay 重建计数器
+     * @return false 如果数据不完整或与当前配置不符
+     */
+    template <class Reader>
+    bool load(Reader &reader)
+    {
+        vector<long long> sizes;
+        long long seconds, savedRetention;
+        uint64_t count;
+        if (!reader.getVector(sizes) || sizes.size() != windowSizes.size() || !reader.get(seconds) || seconds != bucketSeconds
+            || !reader.get(savedRetention) || !reader.get(lastNow) || !reader.get(hasNow) || !reader.get(count))
+        {
+            return false;
+        }
+        windowSizes = sizes;
+        retention = savedRetention;
+        if (ring.size() < count + 1)    ring.resize((size_t)count + 1);
+        head = 0;
+        tail = 0;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            bucket &b = at(tail++);
+            if (!reader.get(b.index) || !reader.get(b.latest) || !reader.get(b.batch) || !reader.getVector(b.counts))    return false;
+        }
+        for (size_t w = 0; w < cursor.size(); w++)
+        {
+            uint64_t offset;
+            if (!reader.get(offset) || offset > count || !reader.get(growing[w]))    return false;
+            cursor[w] = offset;
+        }
+        uint64_t offset;
+        if (!reader.get(offset) || offset > count || !reader.get(flushCount))    return false;
+        retentionCursor = offset;
+        if (!reader.getVector(pending) || !reader.get(offset) || offset > count)    return false;
+        pendingFrom = offset;
+
+        // 与保存前一样，最后一个桶的批次仍等于 flushCount 时其中的词还可能继续合并，待提交列表中的词继续按位置合并
+        fill(lastSerial.begin(), lastSerial.end(), 0);
+        fill(pendingTag.begin(), pendingTag.end(), 0);
+        auto ensure = [this](uint32_t id)
+        {
+            if (id < lastSerial.size())    return;
+            lastSerial.resize(id + 1, 0);
+            lastPos.resize(id + 1, 0);
+            pendingTag.resize(id + 1, 0);
+            pendingPos.resize(id + 1, 0);
+        };
+        if (tail > 0)
+        {
+            const bucket &last = at(tail - 1);
+            for (uint32_t i = 0; i < last.counts.size(); i++)
+            {
+                uint32_t id = last.counts[i].first;
+                ensure(id);
+                lastSerial[id] = tail;
+                lastPos[id] = i;
+            }
+        }
+        for (uint32_t i = 0; i < pending.size(); i++)
+        {
+            uint32_t id = pending[i].first;
+            ensure(id);
+            pendingTag[id] = flushCount + 1;
+            pendingPos[id] = i;
+        }
+        return true;
+    }
+
+    /**
+     * 对每个窗口中仍在窗口内的每个桶的 (词编号, 次数) 调用 f(窗口编号, 词编号, 次数, 批次)，用于恢复后重建计数器
+     * 桶中包含待提交的出现，重建后需用 forEachPending 减去（它们之后由 flush 提交）
+     */
+    template <class F>
+    void replay(F &&f)
+    {
+        for (size_t w = 0; w < windowSizes.size(); w++)
+        {
+            for (unsigned long long s = cursor[w]; s < tail; s++)
+            {
+                const bucket &b = at(s);
+                for (const auto &entry : b.counts)    f(w, entry.first, entry.second, b.batch);
+            }
+        }
+    }
+
+    // 对待提交列表中的每个 (词编号, 次数) 调用 f(词编号, 次数, 批次)
+    template <class F>
+    void forEachPending(F &&f) const
+    {
+        for (const auto &entry : pending)    f(entry.first, entry.second, flushCount);
+    }
+
+    // 对保留的桶和待提交列表中的每个词编号调用 f（同一个词可能多次），用于编号回收
+    template <class F>
+    void forEachId(F &&f) const
+    {
+        for (unsigned long long s = head; s < tail; s++)
+        {
+            for (const auto &entry : ring[(size_t)(s % ring.size())].counts)    f(entry.first);
+        }
+        for (const auto &entry : pending)    f(entry.first);
+    }
+
+    // 当前保留的桶数
+    size_t bucketCount() const
+    {
+        return (size_t)(tail - head);
+    }
+};
+
+#endif
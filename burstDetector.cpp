@@ -0,0 +1,178 @@
+#ifndef BURST_DETECTOR_CPP
+#define BURST_DETECTOR_CPP
+
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/**
+ * 突发检测：按 bucketSeconds 把每个词的出现次数分桶，对已结束的桶的次数维护 EWMA 均值和方差（基线），
+ * 当前桶的次数 x 满足 x >= minCount 且 z = (x - 均值) / 标准差 首次越过阈值时报警，每个词每桶最多一次
+ * 标准差至少取 1，避免次数恒定的词稍有波动就报警；词首次出现后至少经过 warmup 个结束的桶（含空桶）
+ * 才报警，新词的基线（均值 0）还不能代表它平时的次数
+ *
+ * 每个词 16 字节：当前桶编号、当前桶次数、是否已报警、已并入基线的桶数、均值、方差
+ * 桶结束后才把次数并入基线；中间连续 g 个空桶一次性衰减（q = 1 - a）：
+ *   均值 m -> q^g * m，方差 v -> q^g * (v + m^2 * (1 - q^g))
+ * 因此每次出现 O(1)。时间戳早于词当前桶的出现并入当前桶
+ */
+class burstDetector
+{
+private:
+    struct wordBaseline
+    {
+        int32_t bucket = 0;   // 当前桶
+        uint16_t count = 0;   // 当前桶内的次数（饱和），0 表示词还没有出现过
+        uint8_t alerted = 0;  // 当前桶是否已报警
+        uint8_t history = 0;  // 已并入基线的桶数（饱和）
+        float mean = 0;       // 截至 bucket - 1 的 EWMA 均值
+        float variance = 0;   // 截至 bucket - 1 的 EWMA 方差
+    };
+
+    long long bucketSeconds;
+    double alpha;
+    double threshold;
+    int minCount;
+    int warmup;
+    vector<wordBaseline> words;
+    long long alerts = 0;
+    int32_t latest = INT32_MIN; // 见过的最晚的桶
+
+    long long bucketOf(long long timestamp) const
+    {
+        return timestamp >= 0 ? timestamp / bucketSeconds : -((-timestamp + bucketSeconds - 1) / bucketSeconds);
+    }
+
+    // 把当前桶并入基线，再衰减 gap 个空桶
+    void roll(wordBaseline &w, long long gap)
+    {
+        double mean = w.mean, variance = w.variance;
+        double diff = w.count - mean;
+        double increment = alpha * diff;
+        mean += increment;
+        variance = (1 - alpha) * (variance + diff * increment);
+        if (gap > 0)
+        {
+            double decay = pow(1 - alpha, (double)gap);
+            variance = decay * (variance + mean * mean * (1 - decay));
+            mean *= decay;
+        }
+        w.mean = (float)mean;
+        w.variance = (float)variance;
+        long long history = w.history + 1 + gap;
+        w.history = (uint8_t)(history < UINT8_MAX ? history : UINT8_MAX);
+    }
+
+public:
+    // 一次报警：词在当前桶内的次数及报警时的基线
+    class alert
+    {
+    public:
+        int count;
+        double mean;
+        double deviation;
+        double z;
+    };
+
+    /**
+     * @param bucketSeconds 分桶粒度（秒）
+     * @param span 基线 EWMA 的跨度（桶），a = 2 / (span + 1)
+     * @param threshold z-score 阈值
+     * @param minCount 当前桶至少出现这么多次才报警
+     * @param warmup 词首次出现后至少经过这么多个结束的桶才报警（0 ~ 255）
+     */
+    burstDetector(long long bucketSeconds, int span, double threshold, int minCount, int warmup)
+        : bucketSeconds(bucketSeconds > 0 ? bucketSeconds : 1),
+        alpha(2.0 / ((span > 0 ? span : 1) + 1)), threshold(threshold), minCount(minCount > 0 ? minCount : 1),
+        warmup(warmup < 0 ? 0 : (warmup > UINT8_MAX ? UINT8_MAX : warmup)) {}
+
+    /**
+     * 记录一次出现，O(1)
+     * @return true 如果这次出现使当前桶的 z-score 首次越过阈值，此时 result 为报警内容
+     */
+    bool add(uint32_t id, long long timestamp, alert &result)
+    {
+        int32_t b = (int32_t)bucketOf(timestamp);
+        if (b > latest)    latest = b;
+        if (id >= words.size())    words.resize(id + 1);
+        wordBaseline &w = words[id];
+        if (w.count != 0 && b > w.bucket)
+        {
+            roll(w, (long long)b - w.bucket - 1);
+            w.count = 0;
+            w.alerted = 0;
+        }
+        if (w.count == 0)    w.bucket = b;
+        if (w.count < UINT16_MAX)    w.count++;
+        if (w.alerted || w.count < minCount || w.history < warmup)    return false;
+
+        double deviation = sqrt(w.variance > 1 ? (double)w.variance : 1.0);
+        double z = (w.count - w.mean) / deviation;
+        if (z < threshold)    return false;
+        w.alerted = 1;
+        alerts++;
+        result.count = w.count;
+        result.mean = w.mean;
+        result.deviation = deviation;
+        result.z = z;
+        return true;
+    }
+
+    // 保存到检查点
+    template <class Writer>
+    void save(Writer &writer) const
+    {
+        writer.put(bucketSeconds);
+        writer.put(alerts);
+        writer.putVector(words);
+    }
+
+    // 从检查点恢复，分桶粒度不同时返回 false
+    template <class Reader>
+    bool load(Reader &reader)
+    {
+        long long seconds;
+        if (!reader.get(seconds) || seconds != bucketSeconds)    return false;
+        if (!reader.get(alerts) || !reader.getVector(words))    return false;
+        // 最晚的桶的词不会被回收，因此 latest 等于所有词当前桶的最大值
+        for (const wordBaseline &w : words)
+        {
+            if (w.count != 0 && w.bucket > latest)    latest = w.bucket;
+        }
+        return true;
+    }
+
+    // 对基线还不可忽略（当前桶就是最晚的桶，或均值衰减到最晚的桶时不小于 0.01）的词调用 f，用于编号回收
+    template <class F>
+    void forEachActive(F &&f) const
+    {
+        for (uint32_t id = 0; id < words.size(); id++)
+        {
+            const wordBaseline &w = words[id];
+            if (w.count == 0)    continue;
+            double mean = w.mean + alpha * (w.count - w.mean);
+            if (w.bucket >= latest || mean * pow(1 - alpha, (double)latest - w.bucket - 1) >= 0.01)    f(id);
+        }
+    }
+
+    // 编号被回收：丢弃词的基线，复用该编号的新词从头开始
+    void forget(uint32_t id)
+    {
+        if (id < words.size())    words[id] = wordBaseline();
+    }
+
+    long long alertCount() const
+    {
+        return alerts;
+    }
+
+    long long bucketLength() const
+    {
+        return bucketSeconds;
+    }
+};
+
+#endif
@@ -0,0 +1,188 @@
+// 端到端检查的公共部分：在临时目录中生成一个很小的词典（不依赖完整的 jieba 词典，其余由 HMM 切分），
+// 逐行把输入交给 hotWord，每 queryEvery 行（按输入中的行号）查询一次各窗口的前 10 名
+// 检查程序需在仓库根目录运行（使用 dict/hmm_model.utf8、dict/stop_words.utf8 和 input*.txt）
+#ifndef CHECK_FIXTURE_CPP
+#define CHECK_FIXTURE_CPP
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "../hotWord.cpp"
+
+using namespace std;
+
+// hotWord 的构造参数、启用各模块的回调（对应 config.txt 中的同名参数）和每次查询时附加的查询
+struct runOptions
+{
+    long long windowSize = 600;
+    vector<long long> windowSizes;
+    long long retentionSeconds = 0;
+    bool lateData = false;
+    long long allowedLateness = 30;
+    countingOptions counting;
+    size_t windowMessages = 0;
+    int shards = 1;
+    size_t queryEvery = 500;
+    function<void(hotWord &, ofstream &)> setup;
+    function<void(hotWord &, ofstream &)> query;
+};
+
+class checkFixture
+{
+private:
+    string dir;
+
+    void writeFile(const string &name, const string &text)
+    {
+        ofstream ofs(path(name), ios::binary);
+        ofs << text;
+    }
+
+public:
+    checkFixture()
+    {
+        char pattern[] = "/tmp/hotwordCheckXXXXXX";
+        if (mkdtemp(pattern) == nullptr)
+        {
+            cerr << "无法创建临时目录" << endl;
+            exit(2);
+        }
+        dir = pattern;
+        writeFile("jieba.dict.utf8", "我们 5000 r\n他们 3000 r\n一个 4000 m\n没有 3500 v\n什么 3000 r\n自己 2500 r\n"
+                                     "知道 2000 v\n这个 2500 r\n就是 3000 d\n可以 2500 c\n");
+        writeFile("idf.utf8", "我们 2.0\n他们 2.5\n一个 1.5\n");
+        writeFile("user.dict.utf8", "");
+    }
+
+    ~checkFixture()
+    {
+        if (system(("rm -rf '" + dir + "'").c_str()) != 0)    cerr << "无法删除临时目录 " << dir << endl;
+    }
+
+    string path(const string &name) const
+    {
+        return dir + "/" + name;
+    }
+
+    // 按 options 创建 hotWord 并启用各模块；构造和启用时的提示写入 log
+    hotWord *create(const runOptions &options, ofstream &log)
+    {
+        hotWord *hw = new hotWord(path("jieba.dict.utf8"), "dict/hmm_model.utf8", path("user.dict.utf8"), path("idf.utf8"),
+                                  "dict/stop_words.utf8", options.windowSize, log, options.lateData, options.allowedLateness,
+                                  DictTrie::HashTrieBackend, 1, options.counting, options.windowSizes, options.retentionSeconds,
+                                  100000, options.windowMessages, options.shards);
+        if (options.setup)    options.setup(*hw, log);
+        return hw;
+    }
+};
+
+// 读入整个输入文件（每行一项）
+vector<string> ReadLines(const string &path)
+{
+    vector<string> lines;
+    ifstream ifs(path, ios::binary);
+    string line;
+    while (getline(ifs, line))
+    {
+        if (!line.empty() && line.back() == '\r')    line.pop_back();
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// 处理第 [from, to) 行（跳过 ACTION 行），第 i 行处理后若 (i + 1) % queryEvery == 0 则查询各窗口的前 10 名和 options.query
+void Feed(hotWord &hw, ofstream &out, const vector<string> &lines, size_t from, size_t to, const runOptions &options,
+          string &currTime)
+{
+    for (size_t i = from; i < to && i < lines.size(); i++)
+    {
+        if (lines[i].find("ACTION") == string::npos)    currTime = hw.processSentence(lines[i], out);
+        if ((i + 1) % options.queryEvery != 0)    continue;
+        out << "@" << i + 1 << " " << currTime << endl;
+        vector<long long> windows(1, 0);
+        if (options.windowMessages == 0)
+        {
+            for (long long size : options.windowSizes)    windows.push_back(size);
+        }
+        for (long long w : windows)    hw.getTopK(10, out, w);
+        if (options.query)    options.query(hw, out);
+    }
+}
+
+string ReadFile(const string &path)
+{
+    ifstream ifs(path, ios::binary);
+    stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+/**
+ * 把输出中的 Top-K 列表规范化：同次数的词按词排序，且只保留次数大于最后一名的词
+ * （编号不同时并列的词谁排在前面、谁留在第 K 名都可能不同），其余行原样保留
+ */
+string NormalizeTopK(const string &text)
+{
+    stringstream in(text), out;
+    string line;
+    vector<pair<int, string>> block;
+    auto flush = [&]()
+    {
+        if (block.empty())    return;
+        int last = block.back().first;
+        vector<pair<int, string>> kept;
+        for (const auto &entry : block)
+        {
+            if (entry.first > last)    kept.push_back(entry);
+        }
+        sort(kept.begin(), kept.end(), [](const pair<int, string> &a, const pair<int, string> &b)
+            { return a.first != b.first ? a.first > b.first : a.second < b.second; });
+        for (const auto &entry : kept)    out << entry.second << " " << entry.first << endl;
+        out << "（" << block.size() << " 项，最后一名 " << last << " 次）" << endl;
+        block.clear();
+    };
+    while (getline(in, line))
+    {
+        size_t dot = line.find(". "), count = line.find(" (出现次数: ");
+        if (dot != string::npos && count != string::npos && dot > 0 && isdigit((unsigned char)line[0]))
+        {
+            block.push_back(make_pair(atoi(line.c_str() + count + strlen(" (出现次数: ")), line.substr(dot + 2, count - dot - 2)));
+            continue;
+        }
+        flush();
+        out << line << endl;
+    }
+    flush();
+    return out.str();
+}
+
+// 比较两段输出，不同时打印第一处不同的行
+bool SameOutput(const char *name, const string &expected, const string &actual)
+{
+    if (expected == actual)    return true;
+    stringstream a(expected), b(actual);
+    string la, lb;
+    for (size_t line = 1;; line++)
+    {
+        bool hasA = (bool)getline(a, la), hasB = (bool)getline(b, lb);
+        if (!hasA && !hasB)    break;
+        if (hasA && hasB && la == lb)    continue;
+        cout << name << ": 第 " << line << " 行不同" << endl;
+        cout << "  期望: " << (hasA ? la : "<无>") << endl;
+        cout << "  实际: " << (hasB ? lb : "<无>") << endl;
+        break;
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,128 @@
+// 检查点检查：在 input1.txt 的一半处写检查点，新建 hotWord 从中恢复后处理后一半，
+// 后一半的所有查询结果（各窗口的 Top-K、趋势、历史时段、突发报警）和最后的统计必须与不中断的运行完全相同
+// 用法：在仓库根目录运行 check/checkpointCheck（失败时返回非 0）
+#include "checkFixture.cpp"
+
+// 处理 [from, lines.size()) 行后清空迟到缓冲区并输出统计
+void Finish(hotWord &hw, ofstream &out, const vector<string> &lines, size_t from, const runOptions &options,
+            string &currTime)
+{
+    Feed(hw, out, lines, from, lines.size(), options, currTime);
+    hw.forceFlushBuffer(out);
+    hw.printStats(out);
+}
+
+// 不中断地处理全部输入，返回后一半的输出
+string RunUninterrupted(checkFixture &fixture, const runOptions &options, const vector<string> &lines, size_t half)
+{
+    ofstream log(fixture.path("log.txt"));
+    ofstream first(fixture.path("first.txt"), ios::binary), second(fixture.path("second.txt"), ios::binary);
+    hotWord *hw = fixture.create(options, log);
+    string currTime;
+    Feed(*hw, first, lines, 0, half, options, currTime);
+    Finish(*hw, second, lines, half, options, currTime);
+    delete hw;
+    second.close();
+    return ReadFile(fixture.path("second.txt"));
+}
+
+// 处理前一半后写检查点，由新的 hotWord 恢复并处理后一半，返回后一半的输出（恢复失败时返回空串）
+string RunRestored(checkFixture &fixture, const runOptions &options, const vector<string> &lines, size_t half)
+{
+    ofstream log(fixture.path("log.txt"));
+    ofstream first(fixture.path("first.txt"), ios::binary), second(fixture.path("second.txt"), ios::binary);
+    string checkpointPath = fixture.path("checkpoint.bin");
+    checkpointInput input;
+    input.path = "input1.txt";
+    input.lines = (long long)half;
+    string currTime;
+    hotWord *hw = fixture.create(options, log);
+    Feed(*hw, first, lines, 0, half, options, currTime);
+    bool saved = hw->saveCheckpoint(checkpointPath, input, currTime, log);
+    delete hw;
+    if (!saved)    return "";
+
+    hw = fixture.create(options, log);
+    checkpointInput restored;
+    string restoredTime;
+    checkpointStatus status = hw->loadCheckpoint(checkpointPath, restored, restoredTime, log,
+                                                 [](const checkpointInput &) { return true; });
+    if (status != CheckpointRestored || restored.lines != (long long)half || restoredTime != currTime)
+    {
+        delete hw;
+        return "";
+    }
+    Finish(*hw, second, lines, half, options, restoredTime);
+    delete hw;
+    second.close();
+    return ReadFile(fixture.path("second.txt"));
+}
+
+bool RunScenario(checkFixture &fixture, const char *name, const runOptions &options, const vector<string> &lines)
+{
+    size_t half = lines.size() / 2;
+    string expected = RunUninterrupted(fixture, options, lines, half);
+    string actual = RunRestored(fixture, options, lines, half);
+    bool ok = !actual.empty() && SameOutput(name, expected, actual);
+    if (actual.empty())    cout << name << ": 检查点未能写入或恢复" << endl;
+    cout << name << (ok ? ": 通过" : ": 失败") << endl;
+    return ok;
+}
+
+int main()
+{
+    checkFixture fixture;
+    vector<string> lines = ReadLines("input1.txt");
+    bool ok = true;
+
+    runOptions windows;
+    windows.windowSize = 300;
+    windows.windowSizes = {60, 1200};
+    windows.retentionSeconds = 1800;
+    ok &= RunScenario(fixture, "多窗口与保留期", windows, lines);
+
+    runOptions spacesaving = windows;
+    spacesaving.counting.engine = "spacesaving";
+    spacesaving.counting.capacity = 200;
+    ok &= RunScenario(fixture, "spacesaving", spacesaving, lines);
+
+    runOptions countmin = windows;
+    countmin.counting.engine = "countmin";
+    countmin.counting.capacity = 200;
+    ok &= RunScenario(fixture, "countmin", countmin, lines);
+
+    runOptions sharded = windows;
+    sharded.shards = 3;
+    ok &= RunScenario(fixture, "分片", sharded, lines);
+
+    runOptions late = windows;
+    late.lateData = true;
+    late.allowedLateness = 20;
+    late.setup = [](hotWord &hw, ofstream &log) { hw.enableAdaptiveLateness(0.99, log); };
+    ok &= RunScenario(fixture, "迟到缓冲区", late, lines);
+
+    runOptions retroactive = windows;
+    retroactive.lateData = true;
+    retroactive.setup = [](hotWord &hw, ofstream &log) { hw.enableRetroactiveLateData(log); };
+    ok &= RunScenario(fixture, "迟到修正", retroactive, lines);
+
+    runOptions messages;
+    messages.windowMessages = 400;
+    ok &= RunScenario(fixture, "按条数计的窗口", messages, lines);
+
+    runOptions modules = windows;
+    modules.setup = [](hotWord &hw, ofstream &)
+    {
+        hw.enableTrend(60, 5);
+        hw.enableBurstDetection(60, 10, 2.0, 3, 3);
+        hw.enableRollups();
+        hw.enableSymbolRecycling(64);
+    };
+    modules.query = [](hotWord &hw, ofstream &out)
+    {
+        hw.getTrend(5, out);
+        hw.getTopKInRange(10, 0, 1LL << 40, out);
+    };
+    ok &= RunScenario(fixture, "趋势、突发、时间汇总与编号回收", modules, lines);
+    return ok ? 0 : 1;
+}
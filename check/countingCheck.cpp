@@ -0,0 +1,88 @@
+// 计数引擎回归检查：按给定的出现序列同时驱动 spacesaving 和精确计数的分片，
+// 每次查询时检查近似结果满足 计数 - 误差 <= 真实计数 <= 计数，且有空位时不漏掉窗口中的词
+// 用法：check/countingCheck（失败时返回非 0）
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "../counterShard.cpp"
+
+using namespace std;
+
+// 一步操作：在 timestamp 时出现 count 次词 id，query 为 true 时之后查询一次
+struct step
+{
+    long long timestamp;
+    uint32_t id;
+    int count;
+    bool query;
+};
+
+static const char *WORDS[] = {"苹果", "橙子", "香蕉"};
+
+bool RunScenario(const char *name, const vector<step> &steps, size_t capacity, long long windowSize)
+{
+    countingOptions approximate;
+    approximate.engine = "spacesaving";
+    approximate.capacity = capacity;
+    vector<long long> sizes(1, windowSize);
+    counterShard sketch(0, 1, sizes, approximate, 1, 0, 100000);
+    counterShard exact(0, 1, sizes, countingOptions(), 1, 0, 100000);
+
+    bool ok = true;
+    for (const step &s : steps)
+    {
+        for (int i = 0; i < s.count; i++)
+        {
+            sketch.add(s.id, s.timestamp);
+            exact.add(s.id, s.timestamp);
+        }
+        sketch.expire(s.timestamp);
+        exact.expire(s.timestamp);
+        if (!s.query)    continue;
+
+        sketch.flush();
+        exact.flush();
+        vector<topEntry> approx, truth;
+        sketch.topK(0, capacity, approx);
+        exact.topK(0, 100, truth);
+        map<uint32_t, int> trueCount;
+        for (const topEntry &e : truth)    trueCount[e.id] = e.count;
+        map<uint32_t, const topEntry *> reported;
+        for (const topEntry &e : approx)    reported[e.id] = &e;
+
+        for (const topEntry &e : approx)
+        {
+            int real = trueCount.count(e.id) ? trueCount[e.id] : 0;
+            if (e.count - e.error > real || real > e.count)
+            {
+                cout << name << " @" << s.timestamp << ": " << WORDS[e.id] << " 计数 " << e.count << "，误差 " << e.error
+                     << "，真实计数 " << real << endl;
+                ok = false;
+            }
+        }
+        for (const auto &entry : trueCount)
+        {
+            if (reported.count(entry.first) || approx.size() >= capacity)    continue;
+            cout << name << " @" << s.timestamp << ": " << WORDS[entry.first] << " 真实计数 " << entry.second
+                 << "，有空位但不在结果中" << endl;
+            ok = false;
+        }
+    }
+    cout << name << (ok ? ": 通过" : ": 失败") << endl;
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+    // 苹果 x5 @2，橙子 @3，然后在 12、12、13 秒各出现一次并查询
+    ok &= RunScenario("重新进入空位", {
+        {2, 0, 5, false}, {3, 1, 1, false},
+        {12, 1, 1, true}, {12, 0, 1, true}, {13, 1, 1, true}}, 2, 10);
+    // 橙子被香蕉顶替后重新进入，顶替之前计入的出现过期时不应从新的计数中减去
+    ok &= RunScenario("顶替后重新进入", {
+        {1, 0, 9, true}, {2, 1, 5, true}, {3, 2, 6, true},
+        {12, 1, 1, true}, {13, 2, 1, true}}, 2, 10);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+// 词编号回收检查：同一输入分别以不回收和很小的 wordIdRecycleMin（频繁回收）处理，
+// 每次查询的 Top-K 必须相同（并列的词因编号不同可能换位，见 NormalizeTopK）
+// 编号在仍被某个模块引用时被复用，会把次数记到别的词上，查询结果随之不同
+// 用法：在仓库根目录运行 check/recycleCheck（失败时返回非 0）
+#include "checkFixture.cpp"
+
+// 处理 input 的全部行，recycleMin 为 0 时不回收；返回输出和回收轮数
+string RunRecycle(checkFixture &fixture, const runOptions &options, const vector<string> &lines, size_t recycleMin,
+                  long long &rounds)
+{
+    ofstream log(fixture.path("log.txt"));
+    ofstream out(fixture.path("out.txt"), ios::binary);
+    hotWord *hw = fixture.create(options, log);
+    if (recycleMin > 0)    hw->enableSymbolRecycling(recycleMin);
+    string currTime;
+    Feed(*hw, out, lines, 0, lines.size(), options, currTime);
+    rounds = hw->recycleRoundCount();
+    delete hw;
+    out.close();
+    return ReadFile(fixture.path("out.txt"));
+}
+
+bool RunScenario(checkFixture &fixture, const char *name, const runOptions &options, const vector<string> &lines)
+{
+    long long plainRounds, recycledRounds;
+    string plain = RunRecycle(fixture, options, lines, 0, plainRounds);
+    string recycled = RunRecycle(fixture, options, lines, 64, recycledRounds);
+    bool ok = recycledRounds > 0 && SameOutput(name, NormalizeTopK(plain), NormalizeTopK(recycled));
+    if (recycledRounds == 0)    cout << name << ": 没有发生回收" << endl;
+    cout << name << (ok ? ": 通过" : ": 失败") << "（回收 " << recycledRounds << " 轮）" << endl;
+    return ok;
+}
+
+int main()
+{
+    checkFixture fixture;
+    vector<string> lines = ReadLines("input1.txt");
+    bool ok = true;
+
+    runOptions windows;
+    windows.windowSize = 300;
+    windows.windowSizes = {60, 1200};
+    windows.retentionSeconds = 1800;
+    ok &= RunScenario(fixture, "多窗口与保留期", windows, lines);
+
+    runOptions late = windows;
+    late.lateData = true;
+    late.allowedLateness = 20;
+    ok &= RunScenario(fixture, "迟到缓冲区", late, lines);
+
+    runOptions retroactive = windows;
+    retroactive.lateData = true;
+    retroactive.shards = 3;
+    retroactive.setup = [](hotWord &hw, ofstream &log) { hw.enableRetroactiveLateData(log); };
+    ok &= RunScenario(fixture, "迟到修正与分片", retroactive, lines);
+
+    runOptions messages;
+    messages.windowMessages = 400;
+    ok &= RunScenario(fixture, "按条数计的窗口", messages, lines);
+
+    runOptions spacesaving = windows;
+    spacesaving.counting.engine = "spacesaving";
+    spacesaving.counting.capacity = 200;
+    ok &= RunScenario(fixture, "spacesaving", spacesaving, lines);
+
+    runOptions modules = windows;
+    modules.setup = [](hotWord &hw, ofstream &) { hw.enableRollups(); hw.enableTrend(60, 5); };
+    ok &= RunScenario(fixture, "时间汇总与趋势", modules, lines);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+// 快照日志续写检查：处理 input1.txt 的前一半写出快照日志，把 .log 截断在最后一条记录中间，
+// 以更小的 indexEvery 续写后一半；与不截断续写的日志相比只少了被截断的那条记录，
+// 且续写后的第一条记录就写索引项，之后每 indexEvery 条记录至少一个索引项
+// 用法：在仓库根目录运行 check/snapshotLogCheck（失败时返回非 0）
+#include "checkFixture.cpp"
+
+struct logRecord
+{
+    long long time;
+    uint64_t offset;
+};
+
+// 顺序解析 .log 中的每条记录（时间与偏移）
+vector<logRecord> ReadRecords(const string &prefix)
+{
+    vector<logRecord> records;
+    string data = ReadFile(prefix + ".log");
+    const char *begin = data.data(), *end = begin + data.size();
+    const char *p = begin + sizeof(SNAPSHOT_LOG_MAGIC) + sizeof(int64_t);
+    while (p < end)
+    {
+        logRecord record = {0, (uint64_t)(p - begin)};
+        uint64_t value, n, delta, count;
+        if (!GetVarint(p, end, value) || !GetVarint(p, end, n))    break;
+        for (uint64_t i = 0; i < n; i++)
+        {
+            if (!GetVarint(p, end, delta) || !GetVarint(p, end, count))    return records;
+        }
+        record.time = UnZigZag(value);
+        records.push_back(record);
+    }
+    return records;
+}
+
+vector<snapshotIndexEntry> ReadIndex(const string &prefix)
+{
+    string data = ReadFile(prefix + ".idx");
+    size_t count = (data.size() - sizeof(SNAPSHOT_IDX_MAGIC)) / sizeof(snapshotIndexEntry);
+    vector<snapshotIndexEntry> entries(count);
+    if (count > 0)    memcpy(&entries[0], data.data() + sizeof(SNAPSHOT_IDX_MAGIC), count * sizeof(snapshotIndexEntry));
+    return entries;
+}
+
+// 用 snapshotLogReader::scan 逐桶查询 [from, to] 内每个桶的 (词, 次数)
+map<long long, map<string, long long>> ReadBuckets(const string &prefix, long long from, long long to)
+{
+    map<long long, map<string, long long>> buckets;
+    snapshotLogReader reader;
+    if (!reader.open(prefix))    return buckets;
+    for (long long t = from; t <= to; t += reader.bucketLength())
+    {
+        reader.scan(t, t, [&](uint32_t id, long long count) { buckets[t][reader.word(id)] += count; });
+    }
+    return buckets;
+}
+
+// 以 prefix 写（或续写）快照日志，处理第 [from, to) 行
+void WriteLog(checkFixture &fixture, const string &prefix, size_t indexEvery, const vector<string> &lines, size_t from,
+              size_t to)
+{
+    ofstream log(fixture.path("log.txt"), ios::app);
+    ofstream out(fixture.path("out.txt"), ios::binary);
+    runOptions options;
+    hotWord *hw = fixture.create(options, log);
+    hw->enableSnapshotLog(prefix, 60, indexEvery, log);
+    string currTime;
+    Feed(*hw, out, lines, from, to, options, currTime);
+    delete hw;
+}
+
+void CopyLog(const string &from, const string &to)
+{
+    for (const char *suffix : {".log", ".idx", ".dict"})
+    {
+        ofstream ofs(to + suffix, ios::binary);
+        ofs << ReadFile(from + suffix);
+    }
+}
+
+int main()
+{
+    checkFixture fixture;
+    vector<string> lines = ReadLines("input1.txt");
+    size_t half = lines.size() / 2;
+    bool ok = true;
+
+    // 前一半只在第一条记录写索引项，续写时已有的记录数远超续写的 indexEvery
+    const size_t resumeEvery = 3;
+    string first = fixture.path("first"), whole = fixture.path("whole"), cut = fixture.path("cut");
+    WriteLog(fixture, first, 100000, lines, 0, half);
+    vector<logRecord> firstRecords = ReadRecords(first);
+    if (firstRecords.size() < resumeEvery + 2)
+    {
+        cout << "前一半的记录太少: " << firstRecords.size() << endl;
+        return 1;
+    }
+    CopyLog(first, whole);
+    CopyLog(first, cut);
+    string data = ReadFile(cut + ".log");
+    uint64_t lost = firstRecords.back().offset;
+    uint64_t cutAt = lost + (data.size() - lost) / 2;
+    if (!TruncateFile(cut + ".log", cutAt))
+    {
+        cout << "无法截断 " << cut << ".log" << endl;
+        return 1;
+    }
+
+    WriteLog(fixture, whole, resumeEvery, lines, half, lines.size());
+    WriteLog(fixture, cut, resumeEvery, lines, half, lines.size());
+
+    // 截断的记录被丢掉，其余的桶与不截断时相同
+    vector<logRecord> records = ReadRecords(whole);
+    long long lostTime = firstRecords.back().time;
+    map<long long, map<string, long long>> lostCounts = ReadBuckets(first, lostTime, lostTime);
+    map<long long, map<string, long long>> expected = ReadBuckets(whole, records.front().time, records.back().time);
+    for (const auto &entry : lostCounts[lostTime])
+    {
+        long long &count = expected[lostTime][entry.first];
+        count -= entry.second;
+        if (count == 0)    expected[lostTime].erase(entry.first);
+    }
+    if (expected[lostTime].empty())    expected.erase(lostTime);
+    map<long long, map<string, long long>> actual = ReadBuckets(cut, records.front().time, records.back().time);
+    bool sameBuckets = expected == actual;
+    for (auto e = expected.begin(), a = actual.begin(); !sameBuckets && (e != expected.end() || a != actual.end()); ++e, ++a)
+    {
+        if (e != expected.end() && a != actual.end() && *e == *a)    continue;
+        cout << "第一个不同的桶: " << (e != expected.end() ? e->first : a->first) << endl;
+        break;
+    }
+    cout << "截断后续写的记录: " << (sameBuckets ? "通过" : "失败") << endl;
+    ok &= sameBuckets;
+
+    // 续写后的第一条记录有索引项，之后相邻索引项之间不超过 resumeEvery 条记录
+    vector<logRecord> cutRecords = ReadRecords(cut);
+    vector<snapshotIndexEntry> index = ReadIndex(cut);
+    bool dense = true;
+    size_t sinceIndex = 0, next = 0;
+    for (const logRecord &record : cutRecords)
+    {
+        while (next < index.size() && index[next].offset < record.offset)    next++;
+        bool indexed = next < index.size() && index[next].offset == record.offset;
+        sinceIndex = indexed ? 0 : sinceIndex + 1;
+        if (record.offset == lost && !indexed)    dense = false;
+        if (record.offset >= lost && sinceIndex >= resumeEvery)    dense = false;
+    }
+    cout << "续写后的索引项: " << (dense ? "通过" : "失败") << endl;
+    ok &= dense;
+    return ok ? 0 : 1;
+}
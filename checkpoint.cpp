@@ -0,0 +1,167 @@
+#ifndef CHECKPOINT_CPP
+#define CHECKPOINT_CPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// 恢复检查点的结果
+enum checkpointStatus
+{
+    CheckpointRestored, // 已恢复
+    CheckpointSkipped,  // 没有可用的检查点，状态未被修改
+    CheckpointCorrupt   // 恢复到一半失败，状态已不可用
+};
+
+/**
+ * 检查点文件的读写缓冲区
+ * 数值按本机字节序原样写入（只用于同一台机器上的重启），字符串和数组先写长度
+ * 写入时先写到 path.tmp 再改名，读者看到的检查点总是完整的
+ */
+static const char CHECKPOINT_MAGIC[8] = {'H', 'W', 'C', 'K', 'P', 'T', '0', '9'};
+
+class checkpointWriter
+{
+private:
+    string data;
+
+public:
+    checkpointWriter()
+    {
+        data.append(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    }
+
+    // 写入一个可按字节复制的值
+    template <class T>
+    void put(const T &value)
+    {
+        data.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void putString(const string &value)
+    {
+        put<uint64_t>(value.size());
+        data.append(value);
+    }
+
+    // 写入元素可按字节复制的数组
+    template <class T>
+    void putVector(const vector<T> &values)
+    {
+        put<uint64_t>(values.size());
+        if (!values.empty())    data.append(reinterpret_cast<const char *>(&values[0]), values.size() * sizeof(T));
+    }
+
+    size_t size() const
+    {
+        return data.size();
+    }
+
+    // 写到 path.tmp 后改名为 path
+    bool writeFile(const string &path) const
+    {
+        string temp = path + ".tmp";
+        {
+            ofstream ofs(temp, ios::binary | ios::trunc);
+            if (!ofs.is_open())    return false;
+            ofs.write(data.data(), data.size());
+            if (!ofs)    return false;
+        }
+        return rename(temp.c_str(), path.c_str()) == 0;
+    }
+};
+
+/**
+ * 检查点对应的输入：恢复时用来确认当前输入就是写检查点时的那个文件，
+ * 否则按行数跳过“已处理的行”会悄悄丢掉另一个输入的开头
+ */
+struct checkpointInput
+{
+    string path;                    // 配置的输入路径
+    uint64_t device = 0, inode = 0; // 写检查点时输入文件的设备号和 inode（不是普通文件时为 0）
+    uint64_t size = 0;              // 写检查点时输入文件的大小（字节）
+    long long lines = 0;            // 已处理的非空行数
+    uint64_t hash = 0;              // 这些行的指纹（见 InputLineHash）
+
+    template <class Writer>
+    void save(Writer &writer) const
+    {
+        writer.putString(path);
+        writer.put(device);
+        writer.put(inode);
+        writer.put(size);
+        writer.put(lines);
+        writer.put(hash);
+    }
+
+    template <class Reader>
+    bool load(Reader &reader)
+    {
+        return reader.getString(path) && reader.get(device) && reader.get(inode) && reader.get(size)
+            && reader.get(lines) && reader.get(hash);
+    }
+};
+
+class checkpointReader
+{
+private:
+    string data;
+    size_t pos = 0;
+    bool ok = true;
+
+public:
+    // 读入整个文件并检查魔数
+    bool readFile(const string &path)
+    {
+        ifstream ifs(path, ios::binary);
+        if (!ifs.is_open())    return false;
+        data.assign(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+        if (data.size() < sizeof(CHECKPOINT_MAGIC) || memcmp(data.data(), CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0)    return false;
+        pos = sizeof(CHECKPOINT_MAGIC);
+        ok = true;
+        return true;
+    }
+
+    // 数据不足时返回 false，之后的读取都失败
+    template <class T>
+    bool get(T &value)
+    {
+        if (!ok || data.size() - pos < sizeof(T))    return ok = false;
+        memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool getString(string &value)
+    {
+        uint64_t length;
+        if (!get(length) || data.size() - pos < length)    return ok = false;
+        value.assign(data.data() + pos, (size_t)length);
+        pos += (size_t)length;
+        return true;
+    }
+
+    template <class T>
+    bool getVector(vector<T> &values)
+    {
+        uint64_t count;
+        if (!get(count) || (data.size() - pos) / sizeof(T) < count)    return ok = false;
+        values.resize((size_t)count);
+        if (count > 0)    memcpy(static_cast<void *>(&values[0]), data.data() + pos, (size_t)count * sizeof(T));
+        pos += (size_t)count * sizeof(T);
+        return true;
+    }
+
+    bool good() const
+    {
+        return ok;
+    }
+};
+
+#endif
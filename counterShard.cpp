@@ -0,0 +1,416 @@
+#ifndef COUNTER_SHARD_CPP
+#define COUNTER_SHARD_CPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bucketWindow.cpp"
+#include "countingEngine.cpp"
+
+using namespace std;
+
+/**
+ * 单生产者单消费者的无锁环形队列：容量为 2 的幂，生产者只写 tail，消费者只写 head
+ */
+template <class T>
+class spscQueue
+{
+private:
+    vector<T> items;
+    size_t mask;
+    // head 和 tail 分别由两个线程写入，中间隔开一个缓存行避免伪共享
+    atomic<size_t> head{0}; // 下一个要取出的位置（消费者）
+    char padding[64];
+    atomic<size_t> tail{0}; // 下一个要写入的位置（生产者）
+
+public:
+    explicit spscQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)    size *= 2;
+        items.resize(size);
+        mask = size - 1;
+    }
+
+    // 队列满时返回 false
+    bool tryPush(const T &item)
+    {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t - head.load(memory_order_acquire) == items.size())    return false;
+        items[t & mask] = item;
+        tail.store(t + 1, memory_order_seq_cst); // 与消费者的 sleeping 标志配对，见 counterShard::push
+        return true;
+    }
+
+    // 队列空时返回 false
+    bool tryPop(T &item)
+    {
+        size_t h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire))    return false;
+        item = items[h & mask];
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return head.load(memory_order_acquire) == tail.load(memory_order_seq_cst);
+    }
+};
+
+/**
+ * 计数分片：按词编号划分（shard = id % shardCount）的一部分词，拥有自己的计数器和分桶窗口
+ * 分片内部使用局部编号 id / shardCount，计数器和窗口的数组只随本分片的词数增长
+ *
+ * shardCount > 1 时每个分片由一个工作线程独占，计数阶段（唯一的生产者）经 SPSC 队列发送
+ * “出现”和“推进时间”两种操作，计数器和窗口只在工作线程中修改，不需要锁
+ * 查询、调整窗口等操作先调用 quiesce 等待队列中的操作全部应用，此时工作线程空闲，
+ * 计数阶段可以直接读写分片的状态（队列下标的 acquire/release 保证可见性）
+ * shardCount == 1 时不启动线程，操作直接应用，与不分片时完全相同
+ */
+class counterShard
+{
+private:
+    // 队列中的操作：id 为局部编号；id == EXPIRE 表示以 timestamp 为当前时间过期，
+    // id == PUBLISH 表示生成默认窗口的前 publishK 名，timestamp 为请求序号
+    struct shardOp
+    {
+        uint32_t id;
+        long long timestamp;
+    };
+    enum : uint32_t { EXPIRE = 0xFFFFFFFFu, PUBLISH = 0xFFFFFFFEu };
+
+    uint32_t index, shardCount;
+    vector<countingEngine *> counters; // 每个窗口一个
+    bucketWindow window;
+    vector<topEntry> shardResult;
+
+    bool threaded;
+    spscQueue<shardOp> queue;
+    size_t pushed = 0;                // 已发送的操作数（只由生产者访问）
+    atomic<size_t> applied{0};        // 已应用的操作数
+    atomic<bool> sleeping{false};
+    atomic<bool> stopping{false};
+    mutex mtx;
+    condition_variable wake;
+    thread worker;
+    long long lastExpire = 0;
+    bool hasExpired = false;
+
+    // 迟到修正（见 bucketWindow::addLate）：早于最后一个桶的出现直接并入所在的桶
+    bool retroactive = false;
+    long long lateMerged = 0;  // 工作线程写，quiesce 后读
+    long long lateDropped = 0;
+
+    // Top-K 快照的候选：工作线程在 PUBLISH 处生成，publishedSeq 以 release 发布
+    size_t publishK = 0;
+    vector<topEntry> published;
+    atomic<long long> publishedSeq{0};
+
+    void apply(const shardOp &op)
+    {
+        if (op.id == PUBLISH)
+        {
+            flush();
+            published.clear();
+            topK(0, publishK, published);
+            publishedSeq.store(op.timestamp, memory_order_release);
+            return;
+        }
+        if (op.id == EXPIRE)
+        {
+            if (counters[0]->windowed())
+            {
+                for (countingEngine *counter : counters)    counter->expire(op.timestamp);
+                return;
+            }
+            window.advance(op.timestamp,
+                [this](uint32_t id, int count, unsigned long long batch) { submit(id, count, batch); },
+                [this](size_t w, uint32_t id, int count, unsigned long long batch) { counters[w]->decrement(id, count, batch); },
+                [this](size_t w, uint32_t id, int count, unsigned long long batch) { counters[w]->increment(id, count, batch); });
+            return;
+        }
+        // 自带时间窗口的引擎（panesketch）直接接收时间戳，不经过 bucketWindow
+        if (counters[0]->windowed())
+        {
+            for (countingEngine *counter : counters)    counter->add(op.id, op.timestamp);
+            return;
+        }
+        if (retroactive && window.isLate(op.timestamp))
+        {
+            bool counted = window.addLate(op.id, op.timestamp,
+                [this](size_t w, uint32_t id, int count, unsigned long long batch) { counters[w]->increment(id, count, batch); });
+            if (counted)    lateMerged++;
+            else    lateDropped++;
+            return;
+        }
+        window.add(op.id, op.timestamp);
+    }
+
+    // 把合并后的出现次数提交给每个窗口的计数器
+    void submit(uint32_t id, int count, unsigned long long batch)
+    {
+        for (countingEngine *counter : counters)    counter->increment(id, count, batch);
+    }
+
+    void workerLoop()
+    {
+        shardOp op;
+        while (true)
+        {
+            if (queue.tryPop(op))
+            {
+                apply(op);
+                applied.store(applied.load(memory_order_relaxed) + 1, memory_order_release);
+                continue;
+            }
+            // 队列空：先让出几次 CPU，仍然没有数据再睡眠，由生产者唤醒
+            bool found = false;
+            for (int spin = 0; spin < 64 && !found; spin++)
+            {
+                this_thread::yield();
+                found = !queue.empty();
+            }
+            if (found)    continue;
+            unique_lock<mutex> lock(mtx);
+            sleeping.store(true, memory_order_seq_cst);
+            wake.wait(lock, [&]() { return !queue.empty() || stopping.load(); });
+            sleeping.store(false, memory_order_relaxed);
+            if (queue.empty() && stopping.load())    return;
+        }
+    }
+
+    void push(const shardOp &op)
+    {
+        if (!threaded)
+        {
+            apply(op);
+            return;
+        }
+        while (!queue.tryPush(op))    this_thread::yield();
+        pushed++;
+        if (sleeping.load(memory_order_seq_cst))
+        {
+            lock_guard<mutex> lock(mtx);
+            wake.notify_one();
+        }
+    }
+
+public:
+    /**
+     * @param index 分片编号
+     * @param shardCount 分片数，大于 1 时启动工作线程
+     * @param queueCapacity 每个分片队列的容量（操作数）
+     */
+    counterShard(uint32_t index, uint32_t shardCount, const vector<long long> &windowSizes, const countingOptions &counting,
+                 long long bucketSeconds, long long retention, size_t restoreBudget, size_t queueCapacity = 1 << 14)
+        : index(index), shardCount(shardCount > 0 ? shardCount : 1),
+        window(windowSizes, bucketSeconds, retention, restoreBudget),
+        threaded(shardCount > 1), queue(threaded ? queueCapacity : 2)
+    {
+        for (long long size : windowSizes)    counters.push_back(CreateCountingEngine(counting, size));
+        if (threaded)    worker = thread(&counterShard::workerLoop, this);
+    }
+
+    // 启用迟到修正，只能在发送任何操作之前调用
+    void enableRetroactive()
+    {
+        retroactive = true;
+    }
+
+    // 迟到修正的统计：并入窗口的出现数和因早于所有窗口而丢弃的出现数（调用前需先 quiesce）
+    long long lateMergedCount() const
+    {
+        return lateMerged;
+    }
+
+    long long lateDroppedCount() const
+    {
+        return lateDropped;
+    }
+
+    // 记录一次出现（id 为全局编号，调用方保证 id % shardCount == index）
+    void add(uint32_t id, long long timestamp)
+    {
+        push(shardOp{id / shardCount, timestamp});
+    }
+
+    // 以 now 为当前时间过期；多线程时同一时间只发送一次，避免每个句子都向所有分片广播
+    void expire(long long now)
+    {
+        if (threaded && hasExpired && now == lastExpire)    return;
+        lastExpire = now;
+        hasExpired = true;
+        push(shardOp{EXPIRE, now});
+    }
+
+    // 等待已发送的操作全部应用；返回后直到下一次 add / expire 前，下面的函数都可以在计数阶段调用
+    void quiesce()
+    {
+        if (!threaded)    return;
+        while (applied.load(memory_order_acquire) != pushed)    this_thread::yield();
+    }
+
+    /**
+     * 请求在当前位置生成默认窗口的前 k 名（序号 seq 递增），不等待队列清空：
+     * 工作线程处理到这里时提交窗口并取出候选，计数阶段用 topKReady / waitTopK 检查，
+     * 之后 publishedTopK 可读，直到下一次请求；同一时间只能有一个请求未完成
+     */
+    void requestTopK(size_t k, long long seq)
+    {
+        publishK = k;
+        push(shardOp{PUBLISH, seq});
+    }
+
+    bool topKReady(long long seq) const
+    {
+        return publishedSeq.load(memory_order_acquire) == seq;
+    }
+
+    // 只等到工作线程处理完请求 seq，之后发送的操作可以仍在队列中
+    void waitTopK(long long seq) const
+    {
+        while (!topKReady(seq))    this_thread::yield();
+    }
+
+    const vector<topEntry> &publishedTopK() const
+    {
+        return published;
+    }
+
+    // 把窗口中尚未提交的出现交给计数器
+    void flush()
+    {
+        window.flush([this](uint32_t id, int count, unsigned long long batch) { submit(id, count, batch); });
+    }
+
+    /**
+     * 窗口 w 中计数最大的 k 个词（全局编号），追加到 result；与第 k 名计数相同的词一并给出，
+     * 这样合并后按 (计数, 编号) 取前 k 名时，并列的词谁留下与分片数无关
+     * 并列的词较多时多取几次（每次加倍），代价 O(前 k 名加上并列的词数)
+     */
+    void topK(size_t w, size_t k, vector<topEntry> &result)
+    {
+        size_t want = k;
+        counters[w]->topK(want, shardResult);
+        while (k > 0 && shardResult.size() == want && want < counters[w]->size()
+               && shardResult.back().count == shardResult[k - 1].count)
+        {
+            want *= 2;
+            counters[w]->topK(want, shardResult);
+        }
+        for (size_t i = 0; i < shardResult.size(); i++)
+        {
+            topEntry entry = shardResult[i];
+            if (i >= k && (k == 0 || entry.count != shardResult[k - 1].count))    break;
+            entry.id = entry.id * shardCount + index;
+            result.push_back(entry);
+        }
+    }
+
+    // 直接增减计数（只用于不分片的按条数窗口，批次为消息序号）
+    void increment(uint32_t id, int count, unsigned long long batch)
+    {
+        counters[0]->increment(id / shardCount, count, batch);
+    }
+
+    void decrement(uint32_t id, int count, unsigned long long batch)
+    {
+        counters[0]->decrement(id / shardCount, count, batch);
+    }
+
+    // 调整窗口 w 的长度，见 bucketWindow::resize
+    void resize(size_t w, long long size)
+    {
+        window.resize(w, size,
+            [this](uint32_t id, int count, unsigned long long batch) { submit(id, count, batch); },
+            [this](size_t w, uint32_t id, int count, unsigned long long batch) { counters[w]->decrement(id, count, batch); },
+            [this](size_t w, uint32_t id, int count, unsigned long long batch) { counters[w]->increment(id, count, batch); });
+    }
+
+    // 保存到检查点（调用前需先 quiesce）
+    template <class Writer>
+    void save(Writer &writer) const
+    {
+        window.save(writer);
+        writer.put(lateMerged);
+        writer.put(lateDropped);
+        for (const countingEngine *counter : counters)    counter->save(writer);
+    }
+
+    /**
+     * 从检查点恢复窗口和近似引擎的状态，不保存状态的计数器由窗口内的桶重新计入
+     * 只能在发送任何操作之前调用
+     */
+    template <class Reader>
+    bool load(Reader &reader)
+    {
+        if (!window.load(reader) || !reader.get(lateMerged) || !reader.get(lateDropped))    return false;
+        for (countingEngine *counter : counters)
+        {
+            if (!counter->load(reader))    return false;
+        }
+        window.replay([this](size_t w, uint32_t id, int count, unsigned long long batch)
+        {
+            if (!counters[w]->savesState())    counters[w]->increment(id, count, batch);
+        });
+        window.forEachPending([this](uint32_t id, int count, unsigned long long batch)
+        {
+            for (countingEngine *counter : counters)
+            {
+                if (!counter->savesState())    counter->decrement(id, count, batch);
+            }
+        });
+        return true;
+    }
+
+    // 对分片仍引用的每个词（全局编号，可能重复）调用 f：窗口中保留的桶和近似引擎跟踪的词（调用前需先 quiesce）
+    template <class F>
+    void forEachId(F &&f)
+    {
+        window.forEachId([&](uint32_t id) { f(id * shardCount + index); });
+        vector<uint32_t> tracked;
+        for (countingEngine *counter : counters)    counter->trackedIds(tracked);
+        for (uint32_t id : tracked)    f(id * shardCount + index);
+    }
+
+    size_t size(size_t w) const
+    {
+        return counters[w]->size();
+    }
+
+    bool windowed() const
+    {
+        return counters[0]->windowed();
+    }
+
+    long long retentionSeconds() const
+    {
+        return window.retentionSeconds();
+    }
+
+    void printStats(ostream &out) const
+    {
+        counters[0]->printStats(out);
+    }
+
+    ~counterShard()
+    {
+        if (threaded)
+        {
+            {
+                lock_guard<mutex> lock(mtx);
+                stopping.store(true);
+            }
+            wake.notify_one();
+            worker.join();
+        }
+        for (countingEngine *counter : counters)    delete counter;
+    }
+};
+
+#endif
@@ -0,0 +1,548 @@
+#ifndef COUNTING_ENGINE_CPP
+#define COUNTING_ENGINE_CPP
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "checkpoint.cpp"
+#include "streamSummary.cpp"
+
+using namespace std;
+
+// Top-K 查询结果中的一项：error 为计数可能偏高的上界，精确计数时为 0
+struct topEntry
+{
+    uint32_t id;
+    int count;
+    int error;
+};
+
+// 查询结果的顺序：计数从大到小，计数相同时编号小的在前（与分片数、引擎内部的链表顺序无关）
+inline bool RanksBefore(const topEntry &a, const topEntry &b)
+{
+    return a.count != b.count ? a.count > b.count : a.id < b.id;
+}
+
+// 计数引擎的选择与参数（对应 config.txt 中的 countingEngine / engineCapacity / sketchWidth / sketchDepth / paneSeconds）
+struct countingOptions
+{
+    string engine = "exact";  // exact | spacesaving | countmin | panesketch
+    size_t capacity = 1000;   // 近似引擎最多跟踪的词数
+    size_t sketchWidth = 2048;
+    size_t sketchDepth = 4;
+    long long paneSeconds = 60; // panesketch 每个时间片的长度（秒）
+};
+
+// Count-Min 第 row 行中词 id 对应的列：splitmix64 风格的混合，每行使用不同的种子
+inline size_t SketchColumn(size_t row, uint32_t id, size_t width)
+{
+    uint64_t x = (uint64_t)id + 0x9E3779B97F4A7C15ULL * (row + 1);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return (size_t)(x % width);
+}
+
+/**
+ * 计数引擎接口：窗口中的出现按 (词编号, 次数, 批次) 调用 increment，过期时按 (词编号, 次数, 批次) 调用 decrement
+ * 批次是这些出现提交给计数器时的序号（见 bucketWindow::flush），按提交顺序不减；
+ * 过期时传入的批次与这些出现计入时相同
+ */
+class countingEngine
+{
+public:
+    virtual ~countingEngine() {}
+    virtual void increment(uint32_t id, int count, unsigned long long batch) = 0;
+    virtual void decrement(uint32_t id, int count, unsigned long long batch) = 0;
+    // 当前跟踪的词数
+    virtual size_t size() const = 0;
+    // 按计数从大到小取前 k 个
+    virtual void topK(size_t k, vector<topEntry> &result) = 0;
+    // 近似引擎在统计信息中打印自身参数，精确引擎不打印
+    virtual void printStats(ostream &out) const {}
+    // 除窗口中的出现外仍保存状态的词（近似引擎跟踪的词），追加到 ids，用于编号回收
+    virtual void trackedIds(vector<uint32_t> &ids) const {}
+
+    /**
+     * 检查点：默认不保存计数器，恢复时由窗口中的桶重新计入（精确计数只取决于窗口内容）；
+     * 状态还与出现的先后有关的近似引擎（被顶替的词、候选集、误差）返回 true 并按值保存和恢复
+     */
+    virtual bool savesState() const { return false; }
+    virtual void save(checkpointWriter &writer) const {}
+    virtual bool load(checkpointReader &reader) { return true; }
+
+    // 自带时间窗口的引擎（panesketch）直接接收带时间戳的出现，hotWord 不再维护 bucketWindow
+    virtual bool windowed() const { return false; }
+    virtual void add(uint32_t id, long long timestamp) { increment(id, 1, 0); }
+    virtual void expire(long long now) {}
+};
+
+// 精确计数：Stream-Summary 保存所有计数大于 0 的词，内存随词表增长
+class exactCounter : public countingEngine
+{
+private:
+    streamSummary summary;
+    vector<pair<uint32_t, int>> buffer;
+
+public:
+    void increment(uint32_t id, int count, unsigned long long batch) override
+    {
+        summary.increment(id, count);
+    }
+
+    void decrement(uint32_t id, int count, unsigned long long batch) override
+    {
+        summary.decrement(id, count);
+    }
+
+    size_t size() const override
+    {
+        return summary.size();
+    }
+
+    void topK(size_t k, vector<topEntry> &result) override
+    {
+        summary.topK(k, buffer);
+        result.clear();
+        for (const auto &entry : buffer)    result.push_back(topEntry{entry.first, entry.second, 0});
+    }
+};
+
+/**
+ * Space-Saving：最多跟踪 capacity 个词，满了以后新词顶替计数最小的词，
+ * 并继承其计数作为误差上界（计数 - 误差 <= 真实计数 <= 计数）
+ * 窗口过期只减去词在本次进入跟踪之后计入的出现：已被顶替的词的过期次数直接忽略，
+ * 词被顶替后重新进入跟踪时记下当时的批次，早于该批次的出现过期时也忽略（它们已包含在继承的误差中），
+ * 否则顶替前计入的出现会从重新进入后的计数中减去，计数低于真实值
+ * 过期会空出位置：被顶替的词的出现仍在窗口中时，进入空位的词同样继承误差（被顶替时的最大计数）
+ * 所有状态按槽位保存（见 boundedSummary），内存只与 capacity 有关
+ */
+class spaceSavingCounter : public countingEngine
+{
+private:
+    size_t capacity;
+    boundedSummary summary;
+    vector<int> error;                   // 按槽位索引
+    vector<unsigned long long> admitted; // 按槽位索引：最近一次进入跟踪时的批次
+    unsigned long long latestBatch = 0;
+    // 被顶替的词仍在窗口中的出现数的上界，在批次晚于 evictedUntil 的出现开始过期后清零
+    int evictedBound = 0;
+    unsigned long long evictedUntil = 0;
+    vector<pair<uint32_t, int>> buffer;
+
+    void admit(uint32_t id, int inherited, int count)
+    {
+        summary.increment(id, inherited + count);
+        uint32_t slot = summary.slotOf(id);
+        error[slot] = inherited;
+        admitted[slot] = latestBatch;
+    }
+
+public:
+    explicit spaceSavingCounter(size_t capacity)
+        : capacity(capacity > 0 ? capacity : 1), summary(this->capacity),
+        error(this->capacity, 0), admitted(this->capacity, 0) {}
+
+    void increment(uint32_t id, int count, unsigned long long batch) override
+    {
+        if (batch > latestBatch)    latestBatch = batch;
+        if (summary.slotOf(id) != boundedSummary::NONE)
+        {
+            summary.increment(id, count);
+            return;
+        }
+        if (summary.size() < capacity)
+        {
+            admit(id, evictedBound, count);
+            return;
+        }
+        uint32_t victim = summary.minItem();
+        int minCount = summary.count(victim);
+        summary.decrement(victim, minCount);
+        evictedBound = max(evictedBound, minCount);
+        evictedUntil = latestBatch;
+        admit(id, minCount, count);
+    }
+
+    void decrement(uint32_t id, int count, unsigned long long batch) override
+    {
+        if (batch > evictedUntil)    evictedBound = 0;
+        uint32_t slot = summary.slotOf(id);
+        if (slot == boundedSummary::NONE || batch < admitted[slot])    return;
+        int current = summary.count(id);
+        summary.decrement(id, count);
+        if (error[slot] > current - count)    error[slot] = max(current - count, 0);
+    }
+
+    size_t size() const override
+    {
+        return summary.size();
+    }
+
+    void topK(size_t k, vector<topEntry> &result) override
+    {
+        summary.topK(k, buffer);
+        result.clear();
+        for (const auto &entry : buffer)    result.push_back(topEntry{entry.first, entry.second, error[summary.slotOf(entry.first)]});
+    }
+
+    void printStats(ostream &out) const override
+    {
+        out << "计数引擎: spacesaving（最多跟踪 " << capacity << " 个词）" << endl;
+    }
+
+    bool savesState() const override
+    {
+        return true;
+    }
+
+    // 跟踪的词按 topK 的顺序保存，每个词的误差和进入跟踪时的批次按同样的顺序保存
+    void save(checkpointWriter &writer) const override
+    {
+        writer.put(latestBatch);
+        writer.put(evictedBound);
+        writer.put(evictedUntil);
+        summary.save(writer);
+        vector<pair<uint32_t, int>> entries;
+        summary.topK(summary.size(), entries);
+        vector<int> errors;
+        vector<unsigned long long> batches;
+        for (const auto &entry : entries)
+        {
+            errors.push_back(error[summary.slotOf(entry.first)]);
+            batches.push_back(admitted[summary.slotOf(entry.first)]);
+        }
+        writer.putVector(errors);
+        writer.putVector(batches);
+    }
+
+    bool load(checkpointReader &reader) override
+    {
+        vector<int> errors;
+        vector<unsigned long long> batches;
+        if (!reader.get(latestBatch) || !reader.get(evictedBound) || !reader.get(evictedUntil) || !summary.load(reader)
+            || !reader.getVector(errors) || !reader.getVector(batches))
+        {
+            return false;
+        }
+        vector<pair<uint32_t, int>> entries;
+        summary.topK(summary.size(), entries);
+        if (errors.size() != entries.size() || batches.size() != entries.size())    return false;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            error[summary.slotOf(entries[i].first)] = errors[i];
+            admitted[summary.slotOf(entries[i].first)] = batches[i];
+        }
+        return true;
+    }
+
+    void trackedIds(vector<uint32_t> &ids) const override
+    {
+        summary.forEach([&](uint32_t id) { ids.push_back(id); });
+    }
+};
+
+/**
+ * Count-Min Sketch + 候选集：sketch 对所有词计数（可增可减），固定 depth x width 个计数器；
+ * 候选集最多保存 capacity 个估计值最大的词，用容量固定的 Stream-Summary 的最小桶充当最小堆，内存与词表大小无关
+ * 估计值只会偏高，偏高量以概率 1 - e^-depth 不超过 e / width * 窗口总词数
+ */
+class countMinCounter : public countingEngine
+{
+private:
+    size_t capacity;
+    size_t width, depth;
+    vector<int> cells;         // depth 行，每行 width 个计数器
+    long long total = 0;       // 窗口内的总出现次数
+    boundedSummary candidates; // 计数为最近一次的估计值
+    vector<pair<uint32_t, int>> buffer;
+    vector<uint32_t> refresh;
+
+    size_t cell(size_t row, uint32_t id) const
+    {
+        return row * width + SketchColumn(row, id, width);
+    }
+
+    int estimate(uint32_t id) const
+    {
+        int result = cells[cell(0, id)];
+        for (size_t row = 1; row < depth; row++)    result = min(result, cells[cell(row, id)]);
+        return result;
+    }
+
+    int errorBound() const
+    {
+        return (int)ceil(exp(1.0) / width * total);
+    }
+
+public:
+    countMinCounter(size_t capacity, size_t width, size_t depth)
+        : capacity(capacity > 0 ? capacity : 1),
+        width(width > 0 ? width : 1),
+        depth(depth > 0 ? depth : 1),
+        cells(this->width * this->depth, 0),
+        candidates(this->capacity) {}
+
+    void increment(uint32_t id, int count, unsigned long long batch) override
+    {
+        for (size_t row = 0; row < depth; row++)    cells[cell(row, id)] += count;
+        total += count;
+        int est = estimate(id);
+        if (candidates.count(id) > 0 || candidates.size() < capacity)
+        {
+            candidates.set(id, est);
+            return;
+        }
+        uint32_t victim = candidates.minItem();
+        if (est > candidates.count(victim))
+        {
+            candidates.set(victim, 0);
+            candidates.set(id, est);
+        }
+    }
+
+    void decrement(uint32_t id, int count, unsigned long long batch) override
+    {
+        for (size_t row = 0; row < depth; row++)    cells[cell(row, id)] -= count;
+        total -= count;
+        if (candidates.count(id) > 0)    candidates.set(id, estimate(id));
+    }
+
+    size_t size() const override
+    {
+        return candidates.size();
+    }
+
+    // 其它词的增减会让候选的估计值过时，查询前先按 sketch 刷新全部候选（O(capacity * depth)）
+    void topK(size_t k, vector<topEntry> &result) override
+    {
+        candidates.topK(candidates.size(), buffer);
+        refresh.clear();
+        for (const auto &entry : buffer)    refresh.push_back(entry.first);
+        for (uint32_t id : refresh)    candidates.set(id, estimate(id));
+
+        candidates.topK(k, buffer);
+        int bound = errorBound();
+        result.clear();
+        for (const auto &entry : buffer)    result.push_back(topEntry{entry.first, entry.second, min(bound, entry.second)});
+    }
+
+    void printStats(ostream &out) const override
+    {
+        out << "计数引擎: countmin（" << depth << " x " << width << " 个计数器，候选 " << capacity << " 个词）" << endl;
+    }
+
+    // sketch 只取决于窗口内容，但候选集取决于出现的先后，一起保存
+    bool savesState() const override
+    {
+        return true;
+    }
+
+    void save(checkpointWriter &writer) const override
+    {
+        writer.putVector(cells);
+        writer.put(total);
+        candidates.save(writer);
+    }
+
+    bool load(checkpointReader &reader) override
+    {
+        size_t expected = cells.size();
+        return reader.getVector(cells) && cells.size() == expected && reader.get(total) && candidates.load(reader);
+    }
+
+    void trackedIds(vector<uint32_t> &ids) const override
+    {
+        candidates.forEach([&](uint32_t id) { ids.push_back(id); });
+    }
+};
+
+/**
+ * 分片滑动窗口 Sketch：每个时间片（pane，长 paneSeconds 秒）一个小的 Count-Min Sketch，
+ * 另有一个汇总 sketch 等于所有存活时间片之和，点查询只需查汇总 sketch，O(depth)
+ * 时间片在其最后一秒也超出窗口时整片过期：从汇总中减去并清零，代价 O(depth * width)，与词数无关
+ * 内存固定为 (windowSize / paneSeconds + 3) * depth * width 个计数器，不需要逐条或分桶的窗口
+ * Top-K 候选与 countmin 相同：最多 capacity 个估计值最大的词（boundedSummary，O(capacity) 内存），查询前刷新
+ * 时间片边界会让窗口最多多保留 paneSeconds - 1 秒；乱序（时间戳早于最新时间片）的出现并入最新的时间片
+ */
+class paneSketchCounter : public countingEngine
+{
+private:
+    struct pane
+    {
+        long long index = LLONG_MIN; // 时间片编号 floor(timestamp / paneSeconds)，LLONG_MIN 表示空
+        long long total = 0;
+        vector<int> cells;
+    };
+
+    size_t capacity;
+    size_t width, depth;
+    long long windowSize, paneSeconds;
+    vector<pane> panes;        // 时间片 i 位于 panes[i % panes.size()]
+    vector<int> cells;         // 汇总 sketch
+    long long total = 0;       // 窗口内的总出现次数
+    long long oldest = LLONG_MAX; // 可能仍存活的最小时间片编号
+    long long newest = LLONG_MIN;
+    boundedSummary candidates;
+    vector<pair<uint32_t, int>> buffer;
+    vector<uint32_t> refresh;
+
+    long long paneOf(long long timestamp) const
+    {
+        return timestamp >= 0 ? timestamp / paneSeconds : -((-timestamp + paneSeconds - 1) / paneSeconds);
+    }
+
+    pane &slot(long long index)
+    {
+        long long n = (long long)panes.size();
+        return panes[(size_t)(((index % n) + n) % n)];
+    }
+
+    // 时间片过期：从汇总中减去并清空
+    void drop(pane &p)
+    {
+        if (p.total != 0)
+        {
+            for (size_t i = 0; i < cells.size(); i++)    cells[i] -= p.cells[i];
+            fill(p.cells.begin(), p.cells.end(), 0);
+            total -= p.total;
+            p.total = 0;
+        }
+        p.index = LLONG_MIN;
+    }
+
+    int estimate(uint32_t id) const
+    {
+        int result = cells[SketchColumn(0, id, width)];
+        for (size_t row = 1; row < depth; row++)    result = min(result, cells[row * width + SketchColumn(row, id, width)]);
+        return result;
+    }
+
+public:
+    paneSketchCounter(size_t capacity, size_t width, size_t depth, long long windowSize, long long paneSeconds)
+        : capacity(capacity > 0 ? capacity : 1),
+        width(width > 0 ? width : 1),
+        depth(depth > 0 ? depth : 1),
+        windowSize(windowSize),
+        paneSeconds(paneSeconds > 0 ? paneSeconds : 1),
+        cells(this->width * this->depth, 0),
+        candidates(this->capacity)
+    {
+        panes.resize((size_t)(windowSize / this->paneSeconds + 3));
+        for (auto &p : panes)    p.cells.assign(cells.size(), 0);
+    }
+
+    bool windowed() const override
+    {
+        return true;
+    }
+
+    void add(uint32_t id, long long timestamp) override
+    {
+        long long index = paneOf(timestamp);
+        // 乱序的出现并入最新的时间片，内存不随乱序程度增长
+        if (newest != LLONG_MIN && index < newest)    index = newest;
+        pane &p = slot(index);
+        if (p.index != index)
+        {
+            drop(p);
+            p.index = index;
+        }
+        if (index > newest)    newest = index;
+        if (index < oldest)    oldest = index;
+
+        for (size_t row = 0; row < depth; row++)
+        {
+            size_t c = row * width + SketchColumn(row, id, width);
+            p.cells[c]++;
+            cells[c]++;
+        }
+        p.total++;
+        total++;
+
+        int est = estimate(id);
+        if (candidates.count(id) > 0 || candidates.size() < capacity)
+        {
+            candidates.set(id, est);
+            return;
+        }
+        uint32_t victim = candidates.minItem();
+        if (est > candidates.count(victim))
+        {
+            candidates.set(victim, 0);
+            candidates.set(id, est);
+        }
+    }
+
+    // 以 now 为当前时间丢弃过期的时间片：时间片 i 过期当且仅当 (i + 1) * paneSeconds <= now - windowSize
+    void expire(long long now) override
+    {
+        long long limit = paneOf(now - windowSize) - 1;
+        if (limit > newest)    limit = newest;
+        if (limit < oldest)    return;
+        if (limit - oldest >= (long long)panes.size())
+        {
+            for (auto &p : panes)
+            {
+                if (p.index != LLONG_MIN && p.index <= limit)    drop(p);
+            }
+        }
+        else
+        {
+            for (long long index = oldest; index <= limit; index++)
+            {
+                pane &p = slot(index);
+                if (p.index == index)    drop(p);
+            }
+        }
+        oldest = limit + 1;
+    }
+
+    // 没有时间戳的出现记入最新的时间片
+    void increment(uint32_t id, int count, unsigned long long batch) override
+    {
+        for (int i = 0; i < count; i++)    add(id, newest == LLONG_MIN ? 0 : newest * paneSeconds);
+    }
+
+    // 过期以整个时间片为单位，不支持逐词减计数
+    void decrement(uint32_t id, int count, unsigned long long batch) override {}
+
+    size_t size() const override
+    {
+        return candidates.size();
+    }
+
+    void topK(size_t k, vector<topEntry> &result) override
+    {
+        candidates.topK(candidates.size(), buffer);
+        refresh.clear();
+        for (const auto &entry : buffer)    refresh.push_back(entry.first);
+        for (uint32_t id : refresh)    candidates.set(id, estimate(id));
+
+        candidates.topK(k, buffer);
+        int bound = (int)ceil(exp(1.0) / width * total);
+        result.clear();
+        for (const auto &entry : buffer)    result.push_back(topEntry{entry.first, entry.second, min(bound, entry.second)});
+    }
+
+    void printStats(ostream &out) const override
+    {
+        out << "计数引擎: panesketch（" << panes.size() << " 个 " << paneSeconds << " 秒时间片，每片 "
+            << depth << " x " << width << " 个计数器，候选 " << capacity << " 个词）" << endl;
+    }
+};
+
+// 按配置创建计数引擎，未知名称时退回精确计数
+inline countingEngine *CreateCountingEngine(const countingOptions &options, long long windowSize)
+{
+    if (options.engine == "panesketch")
+        return new paneSketchCounter(options.capacity, options.sketchWidth, options.sketchDepth, windowSize, options.paneSeconds);
+    if (options.engine == "spacesaving")    return new spaceSavingCounter(options.capacity);
+    if (options.engine == "countmin")    return new countMinCounter(options.capacity, options.sketchWidth, options.sketchDepth);
+    return new exactCounter();
+}
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef CPPJIEBA_DICT_IMAGE_HPP
+#define CPPJIEBA_DICT_IMAGE_HPP
+
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "limonp/Logging.hpp"
+#include "limonp/StringUtil.hpp"
+#include "limonp/NonCopyable.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cppjieba {
+
+using namespace std;
+
+/*
+ * Precompiled dictionary image.
+ *
+ * One file holds the double-array trie, the dict units (words, weights, tags)
+ * and the HMM tables, so startup skips text parsing, log(), sorting and trie
+ * construction. The file is mapped read-only: trie arrays are used in place,
+ * and processes loading the same image share those physical pages.
+ *
+ * The image also records the size and modification time of every source file
+ * (dict, user dicts, HMM model). Loading refuses the image when a source that
+ * is still present has changed since compiling, so edits are not silently
+ * ignored; an image deployed without its sources loads as is.
+ *
+ * Layout (native byte order, checked through byte_order):
+ *   DictImageHeader
+ *   DictImageSection[section_count]
+ *   section payloads, each 8-byte aligned
+ */
+const char DICT_IMAGE_MAGIC[8] = {'C', 'P', 'P', 'J', 'I', 'E', 'B', 'A'};
+const uint32_t DICT_IMAGE_VERSION = 2;
+const uint32_t DICT_IMAGE_BYTE_ORDER = 0x01020304;
+
+enum DictImageSectionId {
+  kImageDictMeta = 1,          // double[6]: freq_sum, min, max, median, user word default weight, weight option
+  kImageTrieBase,              // int32[cells]
+  kImageTrieCheck,             // int32[cells]
+  kImageTrieValue,             // int32[cells], index into kImageTrieValueUnits
+  kImageTrieValueUnits,        // int32[values], index into the dict units
+  kImageTrieBmpCodes,          // uint32[0x10000]
+  kImageTrieOtherCodes,        // uint32[2 * n]: rune, code
+  kImageUnitWeights,           // double[units]
+  kImageUnitWordOffsets,       // uint32[units + 1]
+  kImageUnitWordRunes,         // uint32[]
+  kImageUnitTagOffsets,        // uint32[units + 1]
+  kImageUnitTagChars,          // char[]
+  kImageUserSingleWords,       // uint32[]
+  kImageHmmStart,              // double[4]
+  kImageHmmTrans,              // double[16]
+  kImageHmmEmitRunes,          // uint32[], the four emit tables concatenated
+  kImageHmmEmitProbs,          // double[]
+  kImageHmmEmitOffsets,        // uint32[5]
+  kImageSources,               // char[]: one "kind\tpath\tsize\tmtime\n" line per source file
+}; // enum DictImageSectionId
+
+struct DictImageHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t section_count;
+  uint32_t reserved;
+}; // struct DictImageHeader
+
+struct DictImageSection {
+  uint32_t id;
+  uint32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+}; // struct DictImageSection
+
+// Read-only view of a whole file, mmap'ed where available.
+class MappedFile: limonp::NonCopyable {
+ public:
+  MappedFile(): data_(NULL), size_(0) {
+  }
+  ~MappedFile() {
+    Close();
+  }
+
+  bool Open(const string& path) {
+    Close();
+#ifdef _WIN32
+    ifstream ifs(path.c_str(), ios::binary);
+    if (!ifs.is_open()) {
+      return false;
+    }
+    buffer_.assign(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+    data_ = buffer_.empty() ? NULL : &buffer_[0];
+    size_ = buffer_.size();
+    return true;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      return false;
+    }
+    void* mapped = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      return false;
+    }
+    data_ = static_cast<const char*>(mapped);
+    size_ = size_t(st.st_size);
+    return true;
+#endif
+  }
+
+  void Close() {
+#ifdef _WIN32
+    vector<char>().swap(buffer_);
+#else
+    if (data_ != NULL) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    data_ = NULL;
+    size_ = 0;
+  }
+
+  const char* Data() const {
+    return data_;
+  }
+  size_t Size() const {
+    return size_;
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+#ifdef _WIN32
+  vector<char> buffer_;
+#endif
+}; // class MappedFile
+
+// Whether the file at path starts with the image magic.
+inline bool IsDictImage(const string& path) {
+  ifstream ifs(path.c_str(), ios::binary);
+  char magic[sizeof(DICT_IMAGE_MAGIC)];
+  if (!ifs.read(magic, sizeof(magic))) {
+    return false;
+  }
+  return memcmp(magic, DICT_IMAGE_MAGIC, sizeof(magic)) == 0;
+}
+
+// A source file an image was compiled from; kind is "dict", "user" or "model".
+struct DictImageSource {
+  string kind;
+  string path;
+  uint64_t size;
+  int64_t mtime;
+}; // struct DictImageSource
+
+// Size and modification time of path; false if it cannot be stat'ed.
+inline bool StatDictSource(const string& path, uint64_t& size, int64_t& mtime) {
+#ifdef _WIN32
+  (void)path;
+  (void)size;
+  (void)mtime;
+  return false;
+#else
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return false;
+  }
+  size = uint64_t(st.st_size);
+  mtime = int64_t(st.st_mtime);
+  return true;
+#endif
+}
+
+inline string EncodeDictSources(const vector<DictImageSource>& sources) {
+  string text;
+  for (size_t i = 0; i < sources.size(); i++) {
+    text += sources[i].kind + "\t" + sources[i].path + "\t" + to_string(sources[i].size) + "\t"
+      + to_string(sources[i].mtime) + "\n";
+  }
+  return text;
+}
+
+inline vector<DictImageSource> DecodeDictSources(const char* data, size_t size) {
+  vector<DictImageSource> sources;
+  string text(data, size);
+  size_t begin = 0;
+  while (begin < text.size()) {
+    size_t end = text.find('\n', begin);
+    XCHECK(end != string::npos) << "dict image source list illegal";
+    vector<string> fields;
+    limonp::Split(text.substr(begin, end - begin), fields, "\t");
+    XCHECK(fields.size() == 4) << "dict image source list illegal";
+    DictImageSource source;
+    source.kind = fields[0];
+    source.path = fields[1];
+    source.size = strtoull(fields[2].c_str(), NULL, 10);
+    source.mtime = strtoll(fields[3].c_str(), NULL, 10);
+    sources.push_back(source);
+    begin = end + 1;
+  }
+  return sources;
+}
+
+// Validated section lookup over a mapped image.
+class DictImageReader {
+ public:
+  explicit DictImageReader(const MappedFile& file)
+   : data_(file.Data()), size_(file.Size()), sections_(NULL), section_count_(0) {
+    XCHECK(size_ >= sizeof(DictImageHeader)) << "dict image truncated";
+    const DictImageHeader* header = reinterpret_cast<const DictImageHeader*>(data_);
+    XCHECK(memcmp(header->magic, DICT_IMAGE_MAGIC, sizeof(DICT_IMAGE_MAGIC)) == 0) << "not a dict image";
+    XCHECK(header->byte_order == DICT_IMAGE_BYTE_ORDER) << "dict image byte order mismatch, recompile it on this machine";
+    XCHECK(header->version == DICT_IMAGE_VERSION) << "dict image version " << header->version
+      << " unsupported (expected " << DICT_IMAGE_VERSION << "), recompile it with --compile-dict";
+    section_count_ = header->section_count;
+    XCHECK(size_ >= sizeof(DictImageHeader) + section_count_ * sizeof(DictImageSection)) << "dict image truncated";
+    sections_ = reinterpret_cast<const DictImageSection*>(data_ + sizeof(DictImageHeader));
+  }
+
+  template <class T>
+  const T* Get(DictImageSectionId id, size_t& count) const {
+    for (size_t i = 0; i < section_count_; i++) {
+      if (sections_[i].id == uint32_t(id)) {
+        XCHECK(sections_[i].offset + sections_[i].size <= size_) << "dict image section " << id << " out of range";
+        count = size_t(sections_[i].size / sizeof(T));
+        return reinterpret_cast<const T*>(data_ + sections_[i].offset);
+      }
+    }
+    XLOG(FATAL) << "dict image section " << id << " missing";
+    count = 0;
+    return NULL;
+  }
+
+  // The recorded source files; fails if one that still exists has changed since compiling.
+  vector<DictImageSource> CheckSources(const string& imagePath) const {
+    size_t count;
+    const char* data = Get<char>(kImageSources, count);
+    vector<DictImageSource> sources = DecodeDictSources(data, count);
+    for (size_t i = 0; i < sources.size(); i++) {
+      uint64_t size;
+      int64_t mtime;
+      if (!StatDictSource(sources[i].path, size, mtime)) {
+        continue;
+      }
+      XCHECK(size == sources[i].size && mtime == sources[i].mtime) << "dict image " << imagePath
+        << " is stale: " << sources[i].path << " changed after compiling, recompile it with --compile-dict";
+    }
+    return sources;
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+  const DictImageSection* sections_;
+  size_t section_count_;
+}; // class DictImageReader
+
+// Collects sections in memory, then writes header, table and payloads.
+class DictImageWriter {
+ public:
+  template <class T>
+  void Add(DictImageSectionId id, const T* data, size_t count) {
+    Section section;
+    section.id = id;
+    section.bytes.assign(reinterpret_cast<const char*>(data), reinterpret_cast<const char*>(data + count));
+    sections_.push_back(section);
+  }
+  template <class T>
+  void Add(DictImageSectionId id, const vector<T>& data) {
+    Add(id, data.empty() ? static_cast<const T*>(NULL) : &data[0], data.size());
+  }
+
+  bool Write(const string& path) const {
+    ofstream ofs(path.c_str(), ios::binary | ios::trunc);
+    if (!ofs.is_open()) {
+      return false;
+    }
+    DictImageHeader header;
+    memcpy(header.magic, DICT_IMAGE_MAGIC, sizeof(header.magic));
+    header.version = DICT_IMAGE_VERSION;
+    header.byte_order = DICT_IMAGE_BYTE_ORDER;
+    header.section_count = uint32_t(sections_.size());
+    header.reserved = 0;
+
+    vector<DictImageSection> table(sections_.size());
+    uint64_t offset = Align(sizeof(DictImageHeader) + sections_.size() * sizeof(DictImageSection));
+    for (size_t i = 0; i < sections_.size(); i++) {
+      table[i].id = sections_[i].id;
+      table[i].reserved = 0;
+      table[i].offset = offset;
+      table[i].size = sections_[i].bytes.size();
+      offset = Align(offset + table[i].size);
+    }
+
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!table.empty()) {
+      ofs.write(reinterpret_cast<const char*>(&table[0]), table.size() * sizeof(DictImageSection));
+    }
+    uint64_t written = sizeof(header) + table.size() * sizeof(DictImageSection);
+    for (size_t i = 0; i < sections_.size(); i++) {
+      Pad(ofs, table[i].offset - written);
+      ofs.write(sections_[i].bytes.data(), sections_[i].bytes.size());
+      written = table[i].offset + table[i].size;
+    }
+    return bool(ofs);
+  }
+
+ private:
+  struct Section {
+    uint32_t id;
+    string bytes;
+  };
+
+  static uint64_t Align(uint64_t offset) {
+    return (offset + 7) & ~uint64_t(7);
+  }
+  static void Pad(ofstream& ofs, uint64_t n) {
+    static const char zeros[8] = {0};
+    ofs.write(zeros, n);
+  }
+
+  vector<Section> sections_;
+}; // class DictImageWriter
+
+} // namespace cppjieba
+
+#endif // CPPJIEBA_DICT_IMAGE_HPP
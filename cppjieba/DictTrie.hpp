@@ -14,6 +14,8 @@
 #include "limonp/Logging.hpp"
 #include "Unicode.hpp"
 #include "Trie.hpp"
+#include "DoubleArrayTrie.hpp"
+#include "DictImage.hpp"
 
 namespace cppjieba {
 
@@ -30,12 +32,24 @@ class DictTrie {
     WordWeightMax,
   }; // enum UserWordWeightOption
 
-  DictTrie(const std::string& dict_path, const std::string& user_dict_paths = "", UserWordWeightOption user_word_weight_opt = WordWeightMedian) {
+  enum TrieBackend {
+    HashTrieBackend,        // Trie: one unordered_map per node
+    DoubleArrayTrieBackend, // DoubleArrayTrie: flat base/check arrays
+  }; // enum TrieBackend
+
+  DictTrie(const std::string& dict_path, const std::string& user_dict_paths = "", UserWordWeightOption user_word_weight_opt = WordWeightMedian,
+        TrieBackend trie_backend = HashTrieBackend)
+    : trie_(NULL), da_trie_(NULL), trie_backend_(trie_backend), user_word_weight_opt_(user_word_weight_opt) {
     Init(dict_path, user_dict_paths, user_word_weight_opt);
   }
 
   ~DictTrie() {
     delete trie_;
+    delete da_trie_;
+  }
+
+  TrieBackend GetTrieBackend() const {
+    return trie_backend_;
   }
 
   bool InsertUserWord(const std::string& word, const std::string& tag = UNKNOWN_TAG) {
@@ -44,7 +58,7 @@ class DictTrie {
       return false;
     }
     active_node_infos_.push_back(node_info);
-    trie_->InsertNode(node_info.word, &active_node_infos_.back());
+    InsertNode(node_info.word, &active_node_infos_.back());
     return true;
   }
 
@@ -55,7 +69,7 @@ class DictTrie {
       return false;
     }
     active_node_infos_.push_back(node_info);
-    trie_->InsertNode(node_info.word, &active_node_infos_.back());
+    InsertNode(node_info.word, &active_node_infos_.back());
     return true;
   }
 
@@ -64,11 +78,18 @@ class DictTrie {
     if (!MakeNodeInfo(node_info, word, user_word_default_weight_, tag)) {
       return false;
     }
-    trie_->DeleteNode(node_info.word, &node_info);
+    if (da_trie_ != NULL) {
+      da_trie_->DeleteNode(node_info.word, &node_info);
+    } else {
+      trie_->DeleteNode(node_info.word, &node_info);
+    }
     return true;
   }
 
   const DictUnit* Find(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end) const {
+    if (da_trie_ != NULL) {
+      return da_trie_->Find(begin, end);
+    }
     return trie_->Find(begin, end);
   }
 
@@ -76,6 +97,10 @@ class DictTrie {
         RuneStrArray::const_iterator end,
         std::vector<struct Dag>&res,
         size_t max_word_len = MAX_WORD_LENGTH) const {
+    if (da_trie_ != NULL) {
+      da_trie_->Find(begin, end, res, max_word_len);
+      return;
+    }
     trie_->Find(begin, end, res, max_word_len);
   }
 
@@ -145,6 +170,36 @@ class DictTrie {
     }
   }
 
+  // Write the static dictionary and its double-array trie into an image.
+  void SaveImage(DictImageWriter& writer) const {
+    XCHECK(da_trie_ != NULL) << "dict image needs the double_array trie backend";
+    double meta[6] = {freq_sum_, min_weight_, max_weight_, median_weight_, user_word_default_weight_,
+                      double(user_word_weight_opt_)};
+    writer.Add(kImageDictMeta, meta, 6);
+
+    std::vector<double> weights;
+    std::vector<uint32_t> wordOffsets(1, 0), wordRunes, tagOffsets(1, 0);
+    std::string tagChars;
+    for (size_t i = 0; i < static_node_infos_.size(); i++) {
+      const DictUnit& unit = static_node_infos_[i];
+      weights.push_back(unit.weight);
+      wordRunes.insert(wordRunes.end(), unit.word.begin(), unit.word.end());
+      wordOffsets.push_back(uint32_t(wordRunes.size()));
+      tagChars += unit.tag;
+      tagOffsets.push_back(uint32_t(tagChars.size()));
+    }
+    writer.Add(kImageUnitWeights, weights);
+    writer.Add(kImageUnitWordOffsets, wordOffsets);
+    writer.Add(kImageUnitWordRunes, wordRunes);
+    writer.Add(kImageUnitTagOffsets, tagOffsets);
+    writer.Add(kImageUnitTagChars, tagChars.data(), tagChars.size());
+
+    std::vector<uint32_t> singleWords(user_dict_single_chinese_word_.begin(), user_dict_single_chinese_word_.end());
+    writer.Add(kImageUserSingleWords, singleWords);
+
+    da_trie_->Save(writer, static_node_infos_.data(), static_node_infos_.size());
+  }
+
   void LoadUserDict(const std::string& filePaths) {
     std::vector<std::string> files = limonp::Split(filePaths, "|;");
     for (size_t i = 0; i < files.size(); i++) {
@@ -164,6 +219,10 @@ class DictTrie {
 
  private:
   void Init(const std::string& dict_path, const std::string& user_dict_paths, UserWordWeightOption user_word_weight_opt) {
+    if (IsDictImage(dict_path)) {
+      LoadImage(dict_path, user_dict_paths, user_word_weight_opt);
+      return;
+    }
     LoadDict(dict_path);
     freq_sum_ = CalcFreqSum(static_node_infos_);
     CalculateWeight(static_node_infos_, freq_sum_);
@@ -185,7 +244,83 @@ class DictTrie {
       valuePointers.push_back(&dictUnits[i]);
     }
 
-    trie_ = new Trie(words, valuePointers);
+    if (trie_backend_ == DoubleArrayTrieBackend) {
+      da_trie_ = new DoubleArrayTrie(words, valuePointers);
+    } else {
+      trie_ = new Trie(words, valuePointers);
+    }
+  }
+
+  // The image already holds the user dict and the weights it was compiled with,
+  // so user_dict_paths and the weight option do not apply here; a mismatch with
+  // what the image was compiled from is logged, a changed source file is fatal.
+  void LoadImage(const std::string& filePath, const std::string& user_dict_paths, UserWordWeightOption user_word_weight_opt) {
+    XCHECK(image_file_.Open(filePath)) << "open " << filePath << " failed.";
+    DictImageReader image(image_file_);
+    std::vector<DictImageSource> sources = image.CheckSources(filePath);
+    std::vector<std::string> compiledUserDicts;
+    for (size_t i = 0; i < sources.size(); i++) {
+      if (sources[i].kind == "user") {
+        compiledUserDicts.push_back(sources[i].path);
+      }
+    }
+    std::vector<std::string> userDicts = limonp::Split(user_dict_paths, "|;");
+    if (userDicts != compiledUserDicts) {
+      XLOG(WARNING) << "dict image " << filePath << " was compiled with user dict '" << limonp::Join(compiledUserDicts.begin(),
+        compiledUserDicts.end(), ";") << "', ignoring '" << user_dict_paths << "'";
+    }
+
+    size_t count;
+    const double* meta = image.Get<double>(kImageDictMeta, count);
+    XCHECK(count == 6) << "dict image meta illegal";
+    freq_sum_ = meta[0];
+    min_weight_ = meta[1];
+    max_weight_ = meta[2];
+    median_weight_ = meta[3];
+    user_word_default_weight_ = meta[4];
+    user_word_weight_opt_ = UserWordWeightOption(int(meta[5]));
+    if (user_word_weight_opt_ != user_word_weight_opt) {
+      XLOG(WARNING) << "dict image " << filePath << " was compiled with user word weight option " << int(meta[5])
+        << ", ignoring " << int(user_word_weight_opt);
+    }
+
+    size_t unitCount, runeCount, tagCount;
+    const double* weights = image.Get<double>(kImageUnitWeights, unitCount);
+    const uint32_t* wordOffsets = image.Get<uint32_t>(kImageUnitWordOffsets, count);
+    XCHECK(count == unitCount + 1) << "dict image unit table illegal";
+    const uint32_t* wordRunes = image.Get<uint32_t>(kImageUnitWordRunes, runeCount);
+    const uint32_t* tagOffsets = image.Get<uint32_t>(kImageUnitTagOffsets, count);
+    XCHECK(count == unitCount + 1) << "dict image unit table illegal";
+    const char* tagChars = image.Get<char>(kImageUnitTagChars, tagCount);
+    XCHECK(wordOffsets[unitCount] <= runeCount && tagOffsets[unitCount] <= tagCount) << "dict image unit table illegal";
+    // Offsets must not decrease, so with the bounds above every unit lies inside its section.
+    for (size_t i = 0; i < unitCount; i++) {
+      XCHECK(wordOffsets[i] <= wordOffsets[i + 1] && tagOffsets[i] <= tagOffsets[i + 1]) << "dict image unit table illegal";
+    }
+
+    static_node_infos_.resize(unitCount);
+    std::vector<const DictUnit*> units(unitCount);
+    for (size_t i = 0; i < unitCount; i++) {
+      DictUnit& unit = static_node_infos_[i];
+      unit.word = Unicode(wordRunes + wordOffsets[i], wordRunes + wordOffsets[i + 1]);
+      unit.weight = weights[i];
+      unit.tag.assign(tagChars + tagOffsets[i], tagChars + tagOffsets[i + 1]);
+      units[i] = &unit;
+    }
+
+    const uint32_t* singleWords = image.Get<uint32_t>(kImageUserSingleWords, count);
+    user_dict_single_chinese_word_.insert(singleWords, singleWords + count);
+
+    trie_backend_ = DoubleArrayTrieBackend;
+    da_trie_ = new DoubleArrayTrie(image, units);
+  }
+
+  void InsertNode(const Unicode& word, const DictUnit* ptValue) {
+    if (da_trie_ != NULL) {
+      da_trie_->InsertNode(word, ptValue);
+    } else {
+      trie_->InsertNode(word, ptValue);
+    }
   }
 
   bool MakeNodeInfo(DictUnit& node_info,
@@ -267,6 +402,10 @@ class DictTrie {
   std::vector<DictUnit> static_node_infos_;
   std::deque<DictUnit> active_node_infos_; // must not be std::vector
   Trie * trie_;
+  DoubleArrayTrie * da_trie_;
+  TrieBackend trie_backend_;
+  UserWordWeightOption user_word_weight_opt_;
+  MappedFile image_file_; // backs da_trie_ when loaded from an image
 
   double freq_sum_;
   double min_weight_;
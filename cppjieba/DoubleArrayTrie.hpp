@@ -0,0 +1,484 @@
+#ifndef CPPJIEBA_DOUBLE_ARRAY_TRIE_HPP
+#define CPPJIEBA_DOUBLE_ARRAY_TRIE_HPP
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
+#include "Trie.hpp"
+#include "DictImage.hpp"
+
+namespace cppjieba {
+
+using namespace std;
+
+/*
+ * Double-array trie with the same interface as Trie.
+ *
+ * Runes are first mapped to dense codes (most frequent rune -> smallest code),
+ * then every transition is two array reads:
+ *   t = base[s] + code(rune);  valid iff check[t] == s
+ * base/check/value live in three flat int32 arrays, so DAG construction walks
+ * contiguous memory instead of chasing one unordered_map per node.
+ *
+ * The static dictionary is built in one pass over the sorted keys. Runtime
+ * InsertNode relocates the parent's children when a cell collides, which is
+ * slower than the hash trie but only used for user words.
+ *
+ * Lookups go through raw array views, which point either at the owned vectors
+ * or straight into a mapped DictImage; the first mutation of an image-backed
+ * trie copies the arrays out of the image.
+ */
+class DoubleArrayTrie {
+ public:
+  DoubleArrayTrie(const vector<Unicode>& keys, const vector<const DictUnit*>& valuePointers)
+   : bmp_codes_(BMP_SIZE, 0), alphabet_size_(0), next_check_pos_(0) {
+    SyncViews();
+    Build(keys, valuePointers);
+    SyncViews();
+  }
+
+  // Attach to the arrays of a mapped image; units[i] is dict unit i of the image.
+  DoubleArrayTrie(const DictImageReader& image, const vector<const DictUnit*>& units)
+   : alphabet_size_(0), next_check_pos_(0) {
+    size_t count;
+    base_view_ = image.Get<int32_t>(kImageTrieBase, cells_);
+    check_view_ = image.Get<int32_t>(kImageTrieCheck, count);
+    XCHECK(count == cells_) << "dict image trie arrays differ in size";
+    value_view_ = image.Get<int32_t>(kImageTrieValue, count);
+    XCHECK(count == cells_) << "dict image trie arrays differ in size";
+    bmp_view_ = image.Get<uint32_t>(kImageTrieBmpCodes, count);
+    XCHECK(count == BMP_SIZE) << "dict image code table size mismatch";
+    const int32_t* valueUnits = image.Get<int32_t>(kImageTrieValueUnits, count);
+    values_.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      XCHECK(valueUnits[i] >= 0 && size_t(valueUnits[i]) < units.size()) << "dict image unit index out of range";
+      values_[i] = units[valueUnits[i]];
+    }
+    const uint32_t* otherCodes = image.Get<uint32_t>(kImageTrieOtherCodes, count);
+    for (size_t i = 0; i + 1 < count; i += 2) {
+      other_codes_[otherCodes[i]] = otherCodes[i + 1];
+    }
+    for (size_t r = 0; r < BMP_SIZE; r++) {
+      alphabet_size_ = max(alphabet_size_, bmp_view_[r]);
+    }
+    for (unordered_map<Rune, uint32_t>::const_iterator it = other_codes_.begin(); it != other_codes_.end(); ++it) {
+      alphabet_size_ = max(alphabet_size_, it->second);
+    }
+  }
+
+  // Write the trie into an image; values must point into units[0, unitCount).
+  void Save(DictImageWriter& writer, const DictUnit* units, size_t unitCount) const {
+    writer.Add(kImageTrieBase, base_view_, cells_);
+    writer.Add(kImageTrieCheck, check_view_, cells_);
+    writer.Add(kImageTrieValue, value_view_, cells_);
+    vector<int32_t> valueUnits(values_.size());
+    for (size_t i = 0; i < values_.size(); i++) {
+      XCHECK(values_[i] >= units && values_[i] < units + unitCount) << "only the static dictionary can be saved";
+      valueUnits[i] = int32_t(values_[i] - units);
+    }
+    writer.Add(kImageTrieValueUnits, valueUnits);
+    writer.Add(kImageTrieBmpCodes, bmp_view_, BMP_SIZE);
+    vector<uint32_t> otherCodes;
+    for (unordered_map<Rune, uint32_t>::const_iterator it = other_codes_.begin(); it != other_codes_.end(); ++it) {
+      otherCodes.push_back(it->first);
+      otherCodes.push_back(it->second);
+    }
+    writer.Add(kImageTrieOtherCodes, otherCodes);
+  }
+
+  const DictUnit* Find(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end) const {
+    if (begin == end) {
+      return NULL;
+    }
+    int32_t s = 0;
+    for (RuneStrArray::const_iterator it = begin; it != end; it++) {
+      s = Next(s, it->rune);
+      if (s < 0) {
+        return NULL;
+      }
+    }
+    return ValueOf(s);
+  }
+
+  void Find(RuneStrArray::const_iterator begin,
+        RuneStrArray::const_iterator end,
+        vector<struct Dag>&res,
+        size_t max_word_len = MAX_WORD_LENGTH) const {
+    res.resize(end - begin);
+
+    for (size_t i = 0; i < size_t(end - begin); i++) {
+      res[i].runestr = *(begin + i);
+
+      int32_t s = Next(0, res[i].runestr.rune);
+      res[i].nexts.push_back(pair<size_t, const DictUnit*>(i, s < 0 ? NULL : ValueOf(s)));
+
+      for (size_t j = i + 1; s >= 0 && j < size_t(end - begin) && (j - i + 1) <= max_word_len; j++) {
+        s = Next(s, (begin + j)->rune);
+        if (s < 0) {
+          break;
+        }
+        const DictUnit* p = ValueOf(s);
+        if (NULL != p) {
+          res[i].nexts.push_back(pair<size_t, const DictUnit*>(j, p));
+        }
+      }
+    }
+  }
+
+  void InsertNode(const Unicode& key, const DictUnit* ptValue) {
+    if (key.begin() == key.end()) {
+      return;
+    }
+    MakeOwned();
+    int32_t s = 0;
+    for (Unicode::const_iterator citer = key.begin(); citer != key.end(); ++citer) {
+      s = AddChild(s, CodeOrAssign(*citer));
+    }
+    SetValue(s, ptValue);
+    SyncViews();
+  }
+
+  void DeleteNode(const Unicode& key, const DictUnit* ptValue) {
+    MakeOwned();
+    int32_t s = 0;
+    for (Unicode::const_iterator citer = key.begin(); citer != key.end(); ++citer) {
+      s = Next(s, *citer);
+      if (s < 0) {
+        return;
+      }
+    }
+    value_[s] = -1;
+  }
+
+  // Number of allocated cells and bytes held by the arrays, for benchmarks.
+  size_t CellCount() const {
+    return cells_;
+  }
+  size_t MemoryBytes() const {
+    return cells_ * sizeof(int32_t) * 3
+      + BMP_SIZE * sizeof(uint32_t)
+      + values_.size() * sizeof(const DictUnit*);
+  }
+
+ private:
+  enum {
+    BMP_SIZE = 0x10000,
+    FREE = -1, // check value of an unused cell
+  };
+
+  // Point the lookup views at the owned arrays (after they may have moved).
+  void SyncViews() {
+    base_view_ = base_.data();
+    check_view_ = check_.data();
+    value_view_ = value_.data();
+    bmp_view_ = bmp_codes_.data();
+    cells_ = base_.size();
+  }
+
+  // Copy image-backed arrays into owned vectors before the first mutation.
+  void MakeOwned() {
+    if (bmp_codes_.empty()) {
+      base_.assign(base_view_, base_view_ + cells_);
+      check_.assign(check_view_, check_view_ + cells_);
+      value_.assign(value_view_, value_view_ + cells_);
+      bmp_codes_.assign(bmp_view_, bmp_view_ + BMP_SIZE);
+      SyncViews();
+    }
+  }
+
+  uint32_t CodeOf(Rune rune) const {
+    if (rune < BMP_SIZE) {
+      return bmp_view_[rune];
+    }
+    unordered_map<Rune, uint32_t>::const_iterator it = other_codes_.find(rune);
+    return it == other_codes_.end() ? 0 : it->second;
+  }
+
+  uint32_t CodeOrAssign(Rune rune) {
+    uint32_t code = CodeOf(rune);
+    if (code == 0) {
+      code = ++alphabet_size_;
+      if (rune < BMP_SIZE) {
+        bmp_codes_[rune] = code;
+      } else {
+        other_codes_[rune] = code;
+      }
+    }
+    return code;
+  }
+
+  int32_t Next(int32_t s, Rune rune) const {
+    uint32_t code = CodeOf(rune);
+    if (code == 0) {
+      return -1;
+    }
+    size_t t = size_t(base_view_[s]) + code;
+    if (t >= cells_ || check_view_[t] != s) {
+      return -1;
+    }
+    return int32_t(t);
+  }
+
+  const DictUnit* ValueOf(int32_t s) const {
+    return value_view_[s] < 0 ? NULL : values_[value_view_[s]];
+  }
+
+  void SetValue(int32_t s, const DictUnit* ptValue) {
+    value_[s] = int32_t(values_.size());
+    values_.push_back(ptValue);
+  }
+
+  void EnsureSize(size_t size) {
+    if (size <= base_.size()) {
+      return;
+    }
+    size_t oldSize = base_.size();
+    size_t newSize = max(size, oldSize + oldSize / 2);
+    base_.resize(newSize, 1);
+    check_.resize(newSize, FREE);
+    value_.resize(newSize, -1);
+    if (!free_next_.empty()) {
+      free_next_.resize(newSize);
+      for (size_t i = oldSize; i < newSize; i++) {
+        free_next_[i] = i;
+      }
+    }
+  }
+
+  // Smallest free cell >= pos while building (union-find with path halving over occupied cells).
+  size_t FindFree(size_t pos) {
+    EnsureSize(pos + 1);
+    while (free_next_[pos] != pos) {
+      free_next_[pos] = free_next_[free_next_[pos]];
+      pos = free_next_[pos];
+      EnsureSize(pos + 1);
+    }
+    return pos;
+  }
+
+  void Occupy(size_t t, int32_t parent) {
+    check_[t] = parent;
+    if (!free_next_.empty()) {
+      EnsureSize(t + 2);
+      free_next_[t] = t + 1;
+    }
+  }
+
+  // Smallest base such that base + code is free for every code (codes sorted ascending).
+  int32_t FindBase(const vector<uint32_t>& codes) {
+    size_t pos = max(size_t(codes[0]) + 1, next_check_pos_);
+    while (true) {
+      if (!free_next_.empty()) {
+        pos = FindFree(pos);
+      } else {
+        EnsureSize(pos + 1);
+        if (check_[pos] != FREE) {
+          pos++;
+          continue;
+        }
+      }
+      size_t base = pos - codes[0];
+      EnsureSize(base + codes.back() + 1);
+      bool ok = true;
+      for (size_t i = 1; i < codes.size(); i++) {
+        if (check_[base + codes[i]] != FREE) {
+          ok = false;
+          break;
+        }
+      }
+      if (ok) {
+        return int32_t(base);
+      }
+      pos++;
+    }
+  }
+
+  void Build(const vector<Unicode>& keys, const vector<const DictUnit*>& valuePointers) {
+    assert(keys.size() == valuePointers.size());
+    // Assign codes by descending rune frequency so common runes get small codes.
+    unordered_map<Rune, size_t> freq;
+    for (size_t i = 0; i < keys.size(); i++) {
+      for (Unicode::const_iterator it = keys[i].begin(); it != keys[i].end(); ++it) {
+        freq[*it]++;
+      }
+    }
+    vector<pair<size_t, Rune> > byFreq;
+    byFreq.reserve(freq.size());
+    for (unordered_map<Rune, size_t>::const_iterator it = freq.begin(); it != freq.end(); ++it) {
+      byFreq.push_back(make_pair(it->second, it->first));
+    }
+    sort(byFreq.begin(), byFreq.end(), greater<pair<size_t, Rune> >());
+    for (size_t i = 0; i < byFreq.size(); i++) {
+      CodeOrAssign(byFreq[i].second);
+    }
+
+    // Keys as code sequences in one flat array, sorted; a later duplicate
+    // overrides an earlier one like Trie::InsertNode.
+    CodeKeys codeKeys;
+    codeKeys.offsets.reserve(keys.size() + 1);
+    codeKeys.offsets.push_back(0);
+    for (size_t i = 0; i < keys.size(); i++) {
+      for (Unicode::const_iterator it = keys[i].begin(); it != keys[i].end(); ++it) {
+        codeKeys.codes.push_back(CodeOf(*it));
+      }
+      codeKeys.offsets.push_back(uint32_t(codeKeys.codes.size()));
+    }
+    vector<uint32_t> order;
+    order.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (codeKeys.Length(i) > 0) {
+        order.push_back(uint32_t(i));
+      }
+    }
+    stable_sort(order.begin(), order.end(), KeyLess(codeKeys));
+
+    values_.reserve(order.size());
+    free_next_.assign(1, 0);
+    EnsureSize(alphabet_size_ + 2);
+    Occupy(0, 0);
+    base_[0] = 1;
+    next_check_pos_ = 1;
+    if (!order.empty()) {
+      BuildNode(0, 0, order, 0, order.size(), codeKeys, valuePointers);
+    }
+    // Runtime inserts scan linearly from the first free cell.
+    next_check_pos_ = FindFree(1);
+    vector<size_t>().swap(free_next_);
+  }
+
+  struct CodeKeys {
+    vector<uint32_t> codes;
+    vector<uint32_t> offsets; // key i is codes[offsets[i], offsets[i + 1])
+    size_t Length(size_t i) const {
+      return offsets[i + 1] - offsets[i];
+    }
+    const uint32_t* Begin(size_t i) const {
+      return codes.data() + offsets[i];
+    }
+  };
+
+  struct KeyLess {
+    const CodeKeys& keys;
+    explicit KeyLess(const CodeKeys& k) : keys(k) {
+    }
+    bool operator()(uint32_t a, uint32_t b) const {
+      return lexicographical_compare(keys.Begin(a), keys.Begin(a) + keys.Length(a),
+            keys.Begin(b), keys.Begin(b) + keys.Length(b));
+    }
+  };
+
+  // Place the children of state s for keys order[lo, hi), which share their first depth codes.
+  void BuildNode(int32_t s, size_t depth, const vector<uint32_t>& order, size_t lo, size_t hi,
+        const CodeKeys& codeKeys, const vector<const DictUnit*>& valuePointers) {
+    // Keys that end here are a prefix of the rest, so they sort first; keep the last duplicate.
+    while (lo < hi && codeKeys.Length(order[lo]) == depth) {
+      if (value_[s] < 0) {
+        SetValue(s, valuePointers[order[lo]]);
+      } else {
+        values_[value_[s]] = valuePointers[order[lo]];
+      }
+      lo++;
+    }
+    if (lo == hi) {
+      return;
+    }
+
+    vector<uint32_t> codes;
+    vector<size_t> bounds;
+    for (size_t i = lo; i < hi; i++) {
+      uint32_t c = codeKeys.Begin(order[i])[depth];
+      if (codes.empty() || codes.back() != c) {
+        codes.push_back(c);
+        bounds.push_back(i);
+      }
+    }
+    bounds.push_back(hi);
+
+    int32_t base = FindBase(codes);
+    base_[s] = base;
+    for (size_t i = 0; i < codes.size(); i++) {
+      Occupy(base + codes[i], s);
+    }
+    for (size_t i = 0; i < codes.size(); i++) {
+      BuildNode(base + codes[i], depth + 1, order, bounds[i], bounds[i + 1], codeKeys, valuePointers);
+    }
+  }
+
+  // Transition from s on code, creating the child (and relocating s's children) if needed.
+  int32_t AddChild(int32_t s, uint32_t code) {
+    size_t t = size_t(base_[s]) + code;
+    EnsureSize(t + 1);
+    if (check_[t] == s) {
+      return int32_t(t);
+    }
+    if (check_[t] == FREE) {
+      check_[t] = s;
+      base_[t] = 1;
+      value_[t] = -1;
+      return int32_t(t);
+    }
+
+    // Collision: move every child of s to a base where they and the new code all fit.
+    vector<uint32_t> codes;
+    for (uint32_t c = 1; c <= alphabet_size_; c++) {
+      size_t x = size_t(base_[s]) + c;
+      if (x < check_.size() && check_[x] == s) {
+        codes.push_back(c);
+      }
+    }
+    codes.push_back(code);
+    sort(codes.begin(), codes.end());
+    int32_t newBase = FindBase(codes);
+    int32_t oldBase = base_[s];
+    for (size_t i = 0; i < codes.size(); i++) {
+      if (codes[i] == code) {
+        continue;
+      }
+      size_t from = size_t(oldBase) + codes[i];
+      size_t to = size_t(newBase) + codes[i];
+      base_[to] = base_[from];
+      value_[to] = value_[from];
+      check_[to] = s;
+      // Grandchildren point back at their parent cell.
+      for (uint32_t c = 1; c <= alphabet_size_; c++) {
+        size_t g = size_t(base_[from]) + c;
+        if (g < check_.size() && check_[g] == int32_t(from)) {
+          check_[g] = int32_t(to);
+        }
+      }
+      check_[from] = FREE;
+      base_[from] = 1;
+      value_[from] = -1;
+    }
+    base_[s] = newBase;
+    t = size_t(newBase) + code;
+    check_[t] = s;
+    base_[t] = 1;
+    value_[t] = -1;
+    return int32_t(t);
+  }
+
+  vector<int32_t> base_;
+  vector<int32_t> check_;
+  vector<int32_t> value_;  // index into values_, -1 if no word ends here
+  vector<const DictUnit*> values_;
+
+  vector<uint32_t> bmp_codes_;  // rune -> code for the BMP, 0 means unknown; empty while image-backed
+  unordered_map<Rune, uint32_t> other_codes_;
+  uint32_t alphabet_size_;
+  size_t next_check_pos_;   // cells below are known to be occupied
+  vector<size_t> free_next_; // only used while building
+
+  // What lookups read: the vectors above, or a mapped image.
+  const int32_t* base_view_;
+  const int32_t* check_view_;
+  const int32_t* value_view_;
+  const uint32_t* bmp_view_;
+  size_t cells_;
+
+}; // class DoubleArrayTrie
+
+} // namespace cppjieba
+
+#endif // CPPJIEBA_DOUBLE_ARRAY_TRIE_HPP
@@ -3,6 +3,7 @@
 
 #include "limonp/StringUtil.hpp"
 #include "Trie.hpp"
+#include "DictImage.hpp"
 
 namespace cppjieba {
 
@@ -27,7 +28,11 @@ struct HMMModel {
     emitProbVec.push_back(&emitProbE);
     emitProbVec.push_back(&emitProbM);
     emitProbVec.push_back(&emitProbS);
-    LoadModel(modelPath);
+    if (IsDictImage(modelPath)) {
+      LoadImage(modelPath);
+    } else {
+      LoadModel(modelPath);
+    }
   }
   ~HMMModel() {
   }
@@ -71,6 +76,48 @@ struct HMMModel {
     XCHECK(GetLine(ifile, line));
     XCHECK(LoadEmitProb(line, emitProbS));
   }
+  void LoadImage(const string& filePath) {
+    MappedFile file;
+    XCHECK(file.Open(filePath)) << "open " << filePath << " failed";
+    DictImageReader image(file);
+    image.CheckSources(filePath);
+    size_t count, runeCount, probCount;
+    const double* start = image.Get<double>(kImageHmmStart, count);
+    XCHECK(count == STATUS_SUM) << "hmm image illegal";
+    memcpy(startProb, start, sizeof(startProb));
+    const double* trans = image.Get<double>(kImageHmmTrans, count);
+    XCHECK(count == STATUS_SUM * STATUS_SUM) << "hmm image illegal";
+    memcpy(transProb, trans, sizeof(transProb));
+
+    const uint32_t* runes = image.Get<uint32_t>(kImageHmmEmitRunes, runeCount);
+    const double* probs = image.Get<double>(kImageHmmEmitProbs, probCount);
+    const uint32_t* offsets = image.Get<uint32_t>(kImageHmmEmitOffsets, count);
+    XCHECK(count == STATUS_SUM + 1 && runeCount == probCount && offsets[STATUS_SUM] <= runeCount) << "hmm image illegal";
+    for (size_t i = 0; i < STATUS_SUM; i++) {
+      XCHECK(offsets[i] <= offsets[i + 1]) << "hmm image illegal";
+      EmitProbMap& mp = *emitProbVec[i];
+      mp.reserve(offsets[i + 1] - offsets[i]);
+      for (size_t j = offsets[i]; j < offsets[i + 1]; j++) {
+        mp[runes[j]] = probs[j];
+      }
+    }
+  }
+  void SaveImage(DictImageWriter& writer) const {
+    writer.Add(kImageHmmStart, startProb, STATUS_SUM);
+    writer.Add(kImageHmmTrans, &transProb[0][0], STATUS_SUM * STATUS_SUM);
+    vector<uint32_t> runes, offsets(1, 0);
+    vector<double> probs;
+    for (size_t i = 0; i < STATUS_SUM; i++) {
+      for (EmitProbMap::const_iterator it = emitProbVec[i]->begin(); it != emitProbVec[i]->end(); ++it) {
+        runes.push_back(it->first);
+        probs.push_back(it->second);
+      }
+      offsets.push_back(uint32_t(runes.size()));
+    }
+    writer.Add(kImageHmmEmitRunes, runes);
+    writer.Add(kImageHmmEmitProbs, probs);
+    writer.Add(kImageHmmEmitOffsets, offsets);
+  }
   double GetEmitProb(const EmitProbMap* ptMp, Rune key, 
         double defVal)const {
     EmitProbMap::const_iterator cit = ptMp->find(key);
@@ -12,8 +12,10 @@ class Jieba {
         const string& model_path = "",
         const string& user_dict_path = "", 
         const string& idf_path = "", 
-        const string& stop_word_path = "") 
-    : dict_trie_(getPath(dict_path, "jieba.dict.utf8"), getPath(user_dict_path, "user.dict.utf8")),
+        const string& stop_word_path = "",
+        DictTrie::TrieBackend trie_backend = DictTrie::HashTrieBackend)
+    : dict_trie_(getPath(dict_path, "jieba.dict.utf8"), getPath(user_dict_path, "user.dict.utf8"),
+                 DictTrie::WordWeightMedian, trie_backend),
       model_(getPath(model_path, "hmm_model.utf8")),
       mp_seg_(&dict_trie_),
       hmm_seg_(&model_),
@@ -116,7 +118,42 @@ class Jieba {
     dict_trie_.LoadUserDict(path);
   }
 
+  // Compile dict + user dict + HMM model into one image loadable through
+  // dict_path and model_path. Needs no idf / stop words.
+  static bool CompileDictImage(const string& dict_path,
+        const string& model_path,
+        const string& user_dict_path,
+        const string& image_path) {
+    DictTrie dict_trie(getPath(dict_path, "jieba.dict.utf8"), getPath(user_dict_path, "user.dict.utf8"),
+                       DictTrie::WordWeightMedian, DictTrie::DoubleArrayTrieBackend);
+    HMMModel model(getPath(model_path, "hmm_model.utf8"));
+    DictImageWriter writer;
+    dict_trie.SaveImage(writer);
+    model.SaveImage(writer);
+
+    vector<DictImageSource> sources;
+    AddDictSource(sources, "dict", getPath(dict_path, "jieba.dict.utf8"));
+    vector<string> user_dicts = limonp::Split(getPath(user_dict_path, "user.dict.utf8"), "|;");
+    for (size_t i = 0; i < user_dicts.size(); i++) {
+      AddDictSource(sources, "user", user_dicts[i]);
+    }
+    AddDictSource(sources, "model", getPath(model_path, "hmm_model.utf8"));
+    string source_text = EncodeDictSources(sources);
+    writer.Add(kImageSources, source_text.data(), source_text.size());
+    return writer.Write(image_path);
+  }
+
  private:
+  static void AddDictSource(vector<DictImageSource>& sources, const string& kind, const string& path) {
+    DictImageSource source;
+    source.kind = kind;
+    source.path = path;
+    source.size = 0;
+    source.mtime = 0;
+    StatDictSource(path, source.size, source.mtime);
+    sources.push_back(source);
+  }
+
   static string pathJoin(const string& dir, const string& filename) {
     if (dir.empty()) {
         return filename;
@@ -0,0 +1,98 @@
+#ifndef DELAY_HISTOGRAM_CPP
+#define DELAY_HISTOGRAM_CPP
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/**
+ * 延迟分布的流式分位数估计：对数分桶的直方图，内存固定（约 1000 个计数）
+ * 0 ~ 63 秒每秒一个桶，之后每个 2 的幂区间分 16 个桶，分位数的相对误差不超过 1/16；
+ * 查询返回所在桶的上界（对允许延迟而言偏保守）
+ * 样本数达到 decayEvery 时所有计数减半，较早的延迟权重按几何级数衰减，分布变化后分位数随之跟上
+ */
+class delayHistogram
+{
+private:
+    enum { LINEAR = 64, SUB_BITS = 4, SUB = 1 << SUB_BITS, LINEAR_BITS = 6 };
+
+    vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t decayEvery;
+
+    static size_t bucketOf(uint64_t delay)
+    {
+        if (delay < LINEAR)    return (size_t)delay;
+        int exponent = 63 - __builtin_clzll(delay); // delay 的最高位，>= LINEAR_BITS
+        size_t sub = (size_t)(delay >> (exponent - SUB_BITS)) & (SUB - 1);
+        return LINEAR + (size_t)(exponent - LINEAR_BITS) * SUB + sub;
+    }
+
+    // 桶内的最大延迟
+    static uint64_t upperBound(size_t bucket)
+    {
+        if (bucket < LINEAR)    return bucket;
+        int exponent = (int)((bucket - LINEAR) / SUB) + LINEAR_BITS;
+        uint64_t sub = (bucket - LINEAR) % SUB;
+        uint64_t width = 1ULL << (exponent - SUB_BITS);
+        return ((SUB + sub) << (exponent - SUB_BITS)) + width - 1;
+    }
+
+public:
+    explicit delayHistogram(uint64_t decayEvery = 1 << 16)
+        : counts(LINEAR + (64 - LINEAR_BITS) * SUB, 0), decayEvery(decayEvery > 1 ? decayEvery : 2) {}
+
+    // 记录一个延迟样本（秒，负数按 0 计），O(1)
+    void add(long long delay)
+    {
+        counts[bucketOf(delay > 0 ? (uint64_t)delay : 0)]++;
+        if (++total < decayEvery)    return;
+        total = 0;
+        for (uint64_t &count : counts)
+        {
+            count >>= 1;
+            total += count;
+        }
+    }
+
+    // 当前（衰减后的）样本数
+    uint64_t size() const
+    {
+        return total;
+    }
+
+    /**
+     * 延迟的 q 分位数（q 在 0 ~ 1 之间），O(桶数)；没有样本时返回 0
+     */
+    long long quantile(double q) const
+    {
+        if (total == 0)    return 0;
+        uint64_t rank = (uint64_t)(q * total);
+        if (rank >= total)    rank = total - 1;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < counts.size(); b++)
+        {
+            seen += counts[b];
+            if (seen > rank)    return (long long)upperBound(b);
+        }
+        return (long long)upperBound(counts.size() - 1);
+    }
+
+    // 保存到检查点
+    template <class Writer>
+    void save(Writer &writer) const
+    {
+        writer.put(total);
+        writer.putVector(counts);
+    }
+
+    template <class Reader>
+    bool load(Reader &reader)
+    {
+        size_t buckets = counts.size();
+        return reader.get(total) && reader.getVector(counts) && counts.size() == buckets;
+    }
+};
+
+#endif
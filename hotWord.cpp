@@ -5,59 +5,95 @@
 #include <string>
 #include <vector>
 #include <cstdlib>
-#include <unordered_map> // 用于哈希表存储词频
-#include <queue>         // 用于滑动窗口实现
+#include <cstring>
+#include <climits>
 #include <set>           // 用于存储停用词
+#include <iomanip>
 
 using namespace std;
 using namespace cppjieba;
-class wordEntry;
 #include "lateDataHandler.cpp"
-// 用于滑动窗口
-class wordEntry
-{
-    public:
-    string word;
-    long long timeStamp;
-    
-    wordEntry(const string &word, long long timeStamp)
-    : word(word), timeStamp(timeStamp) {}
-};
+#include "timestampParser.cpp"
+#include "symbolTable.cpp"
+#include "bucketWindow.cpp"
+#include "messageWindow.cpp"
+#include "countingEngine.cpp"
+#include "counterShard.cpp"
+#include "topKSnapshot.cpp"
+#include "trendTracker.cpp"
+#include "burstDetector.cpp"
+#include "snapshotLog.cpp"
+#include "timeRollup.cpp"
+#include "checkpoint.cpp"
 
-// 热词提取类
-class wordCount
+// 一个句子的分词结果：分词阶段产生，计数阶段消费
+class segmentedLine
 {
 public:
-    string word;
-    int count;
-
-    wordCount(const string &word, int count)
-        : word(word), count(count) {}
-};
-// 比较器：用于优先队列，按词频从大到小排序
-class cmpWordCount
-{
-public:
-    bool operator()(const wordCount &a, const wordCount &b)
-    {
-        return a.count < b.count; // 词频较大的优先级较高
-    }
+    long long timestamp = -1;
+    string timestr;        // 原始时间戳字符串（含方括号）
+    string content;        // 句子内容
+    vector<string> words;  // 分词结果
 };
 
-
-
 class hotWord
 {
 private:
     // 分词模块
     cppjieba::Jieba *jieba;
 
-    // 计数器
-    unordered_map<string, int> Counter;
+    // 符号表：词 <-> 编号
+    symbolTable symbols;
+    // 每个编号是否为停用词（在分配编号时判定一次）
+    vector<char> isStopWord;
+
+    // 编号回收（见 collectSymbols）：自上次回收以来新分配了 recycleEvery 个编号后，
+    // 在下一个句子开始前释放不再被引用的词的编号；recycleMin 为 0 时不回收
+    size_t recycleMin = 0;
+    size_t recycleEvery = 0;
+    size_t internedSinceRecycle = 0;
+    long long recycleRounds = 0;
+    long long recycledIds = 0;
+
+    // 计数分片：按词编号划分，每个分片有自己的计数器（每个窗口一个，见 countingEngine.cpp）
+    // 和分桶滑动窗口（按 bucketSeconds 分桶聚合，所有窗口长度共用，见 bucketWindow.cpp）
+    // 分片数大于 1 时每个分片由一个线程独占，经 SPSC 队列接收出现（见 counterShard.cpp）
+    vector<counterShard *> shards;
+    bool approximateCounting;
+    // Top-K 查询结果缓冲区（跨查询复用）
+    vector<topEntry> topResult;
+
+    // Top-K 快照：每处理 snapshotInterval 个句子请求一次默认窗口的前 snapshotK 名，
+    // 各分片的工作线程生成候选后由计数阶段合并发布，其他线程通过 readTopK 读取
+    snapshotPublisher snapshots;
+    size_t snapshotK = 0;
+    long long snapshotInterval = 0; // 0 表示不发布
+    long long sinceSnapshot = 0;
+    long long snapshotSeq = 0;      // 最近一次请求的序号
+    bool snapshotPending = false;   // 最近一次请求还没有发布
+    string pendingAsOf;
+    long long pendingSentences = 0;
+
+    // 词的变化趋势（每次出现 O(1) 更新，见 trendTracker.cpp），为空时不统计
+    trendTracker *trends = nullptr;
 
-    // 滑动窗口
-    queue<wordEntry> window;
-    long long windowSize = 600; // 时间窗口大小
+    // 突发检测（见 burstDetector.cpp），为空时不检测；报警行以正在处理的句子的时间戳开头
+    burstDetector *bursts = nullptr;
+    string currentTime;
+
+    // 窗口快照日志（见 snapshotLog.cpp），为空时不写
+    snapshotLogWriter *snapshotLog = nullptr;
+
+    // 分钟 / 小时 / 天汇总（见 timeRollup.cpp），为空时不汇总
+    timeRollup *rollups = nullptr;
+    vector<long long> rangeCounts; // 历史查询按编号累加的次数（跨查询复用，查询结束时只清零用到的编号）
+
+    long long windowSize = 600; // 默认窗口大小
+    vector<long long> windowSizes; // 所有窗口长度，windowSizes[0] == windowSize，下标即窗口编号
+
+    // 按消息条数计的窗口（windowPolicy=count 时使用，否则为空）
+    messageWindow *messages = nullptr;
+    vector<uint32_t> messageIds; // 当前消息的非停用词（跨句子复用）
 
     // 停用词
     set<string> stopWords;
@@ -66,8 +102,17 @@ private:
     long long totalWords = 0;
     long long totalSentences = 0;
 
-    LateDataHandler<wordEntry> *lateDataHandler;
+    // 迟到数据处理：按句子缓冲非停用词的编号（见 symbolTable.cpp）
+    LateDataHandler<uint32_t> *lateDataHandler;
+    vector<uint32_t> lateIds; // 当前句子的非停用词（跨句子复用）
+    // 迟到修正模式（lateDataMode=retroactive）：不经过重排序缓冲区，迟到的出现直接并入窗口中其时间所在的桶，
+    // 窗口以见过的最晚时间过期（见 bucketWindow::addLate）
+    bool retroactiveLate = false;
+    long long latestTimestamp = LLONG_MIN;
     bool enableLateDataHandling;
+
+    // 单线程路径的分词结果缓冲区（跨句子复用）
+    segmentedLine scratchLine;
 public:
     hotWord(const string &dict_path,
             const string &model_path,
@@ -77,20 +122,60 @@ public:
             long long windowSize,
             ofstream &out,
             bool enableLateDataHandling = false,
-            long long allowedLateness = 30    
+            long long allowedLateness = 30,
+            DictTrie::TrieBackend trieBackend = DictTrie::HashTrieBackend,
+            long long bucketSeconds = 1,
+            const countingOptions &counting = countingOptions(),
+            const vector<long long> &extraWindowSizes = vector<long long>(),
+            long long retentionSeconds = 0,
+            size_t restoreBudget = 100000,
+            size_t windowMessages = 0,
+            int shardCount = 1
         )
         : windowSize(windowSize),
+        windowSizes(MergeWindowSizes(windowSize, extraWindowSizes)),
         enableLateDataHandling(enableLateDataHandling)
     {
         // 分词模块
-        jieba = new cppjieba::Jieba(dict_path, model_path, user_dict_path, idf_path, stop_word_path);
+        jieba = new cppjieba::Jieba(dict_path, model_path, user_dict_path, idf_path, stop_word_path, trieBackend);
+
+        // 计数分片，每个分片中每个窗口一个计数引擎
+        approximateCounting = counting.engine == "spacesaving" || counting.engine == "countmin" || counting.engine == "panesketch";
+        if (windowMessages > 0)
+        {
+            // 按条数计的窗口只有一个，且不按时间过期
+            messages = new messageWindow(windowMessages);
+            countingOptions messageCounting = counting;
+            if (messageCounting.engine == "panesketch")
+            {
+                out << "panesketch 按时间片过期，不适用于按条数计的窗口，改用 countmin。" << endl;
+                messageCounting.engine = "countmin";
+            }
+            windowSizes.resize(1); // 额外的时间窗口不适用
+            shards.push_back(new counterShard(0, 1, windowSizes, messageCounting, bucketSeconds, retentionSeconds, restoreBudget));
+            out << "按消息条数计的窗口：最近 " << windowMessages << " 条消息" << endl;
+        }
+        else
+        {
+            if (shardCount < 1)    shardCount = 1;
+            for (int i = 0; i < shardCount; i++)
+            {
+                shards.push_back(new counterShard(i, shardCount, windowSizes, counting, bucketSeconds, retentionSeconds, restoreBudget));
+            }
+            if (shardCount > 1)    out << "计数分片已启用，分片数: " << shardCount << endl;
+        }
 
         // 加载停用词
         loadStopWords(stop_word_path, out);
-        // 初始化迟到数据处理模块
-        if (enableLateDataHandling)
+        // 初始化迟到数据处理模块：按条数计的窗口按到达顺序计数，不需要重排
+        if (enableLateDataHandling && messages != nullptr)
+        {
+            this->enableLateDataHandling = false;
+            out << "按条数计的窗口按到达顺序计数，忽略迟到/乱序数据处理。" << endl;
+        }
+        if (this->enableLateDataHandling)
         {
-            lateDataHandler = new LateDataHandler<wordEntry>(allowedLateness, 10000, out);
+            lateDataHandler = new LateDataHandler<uint32_t>(allowedLateness, 10000, out);
             out << "迟到/乱序数据处理功能已启用" << endl;
         }
         else
@@ -121,54 +206,253 @@ public:
         out << "停用词加载完成，总共 " << stopWords.size() << " 个停用词。" << endl;
     }
 
-    // 处理时间戳函数
-    long long Timestamp(const string &timeStr)
+    // 词 -> 编号：新词（或复用回收编号的词）在这里分配编号并判定是否为停用词
+    uint32_t intern(const string &word)
+    {
+        bool added;
+        uint32_t id = symbols.intern(word, added);
+        if (!added)    return id;
+        if (id >= isStopWord.size())    isStopWord.resize(id + 1, 0);
+        isStopWord[id] = stopWords.count(word) ? 1 : 0;
+        internedSinceRecycle++;
+        return id;
+    }
+
+    /**
+     * 编号回收：标记仍被引用的词——分片窗口保留的桶（含保留期）和待提交列表、近似引擎跟踪的词、
+     * 按条数计的窗口、迟到缓冲区、快照日志的当前记录、时间汇总，以及趋势 / 突发基线还不可忽略的词，
+     * 其余词的编号交还符号表，按编号索引的趋势、突发和快照日志状态随之清除
+     * 只在句子之间调用（此时当前句子的词都已进入上述结构）；代价 O(编号上界 + 被引用的项数)，
+     * 每新分配 max(recycleMin, 上次回收后的在用词数) 个编号才做一次，摊还到每个新词 O(1)
+     */
+    void collectSymbols()
+    {
+        internedSinceRecycle = 0;
+        for (counterShard *shard : shards)    shard->quiesce();
+        finishSnapshot(false); // 候选中的词在回收前换成词本身
+        vector<char> used(symbols.size(), 0);
+        auto mark = [&](uint32_t id) { used[id] = 1; };
+        for (counterShard *shard : shards)    shard->forEachId(mark);
+        if (messages != nullptr)    messages->forEachId(mark);
+        if (lateDataHandler != nullptr)    lateDataHandler->forEachItem(mark);
+        if (snapshotLog != nullptr)    snapshotLog->forEachId(mark);
+        if (rollups != nullptr)    rollups->forEachId(mark);
+        if (trends != nullptr)    trends->forEachActive(mark);
+        if (bursts != nullptr)    bursts->forEachActive(mark);
+        for (uint32_t id = 0; id < symbols.size(); id++)
+        {
+            if (used[id] || !symbols.live(id))    continue;
+            symbols.release(id);
+            if (trends != nullptr)    trends->forget(id);
+            if (bursts != nullptr)    bursts->forget(id);
+            if (snapshotLog != nullptr)    snapshotLog->forget(id);
+            recycledIds++;
+        }
+        recycleRounds++;
+        recycleEvery = max(recycleMin, symbols.liveCount());
+    }
+
+    /**
+     * 启用编号回收：每新分配 max(minInterned, 在用词数) 个编号回收一次不再被引用的词
+     * 自带时间片窗口的引擎（panesketch）的 sketch 中仍有已过期词的计数，不支持回收
+     */
+    void enableSymbolRecycling(size_t minInterned)
+    {
+        if (shards[0]->windowed())    return;
+        recycleMin = minInterned;
+        recycleEvery = minInterned;
+    }
+
+    // 已做过的回收轮数（printStats 中也会输出）
+    long long recycleRoundCount() const
+    {
+        return recycleRounds;
+    }
+
+    // 默认窗口在前，去掉重复和非正的长度
+    static vector<long long> MergeWindowSizes(long long windowSize, const vector<long long> &extra)
+    {
+        vector<long long> sizes(1, windowSize);
+        for (long long size : extra)
+        {
+            if (size > 0 && find(sizes.begin(), sizes.end(), size) == sizes.end())    sizes.push_back(size);
+        }
+        return sizes;
+    }
+
+    // 等待所有分片应用完已发送的出现，并把窗口中尚未提交的出现交给计数器
+    void submitPending()
+    {
+        for (counterShard *shard : shards)    shard->quiesce();
+        for (counterShard *shard : shards)    shard->flush();
+    }
+
+    // 把一次出现交给词所在的分片；计数器在查询前或过期前才按词合并提交
+    void windowWord(uint32_t id, long long timestamp)
+    {
+        if (trends != nullptr)    trends->add(id, timestamp);
+        if (snapshotLog != nullptr)    snapshotLog->add(id, timestamp);
+        if (rollups != nullptr)    rollups->add(id, timestamp);
+        shards[id % shards.size()]->add(id, timestamp);
+    }
+
+    // 随计数更新检查词是否突发，越过阈值时输出一条报警
+    void checkBurst(uint32_t id, long long timestamp, ostream &out)
+    {
+        burstDetector::alert alert;
+        if (bursts == nullptr || !bursts->add(id, timestamp, alert))    return;
+        out << currentTime << " 突发热词: " << symbols.word(id) << "（本桶 " << alert.count << " 次，基线 "
+            << fixed << setprecision(2) << alert.mean << " ± " << alert.deviation << "，z = " << alert.z << "）"
+            << defaultfloat << setprecision(6) << endl;
+    }
+
+    // 以 now 为当前时间移除每个窗口中过期的桶
+    void expireWindow(long long now)
     {
-        // 检查格式
-        if (timeStr.length() < 3 || timeStr[0] != '[' || timeStr[timeStr.length() - 1] != ']')
+        for (counterShard *shard : shards)    shard->expire(now);
+    }
+
+    /**
+     * 在线调整窗口长度：缩小时立即移除过期的桶；放大时从保留的历史桶中恢复，
+     * 每次调用（以及之后每个句子）最多重新计入 restoreBudget 个 (词, 次数) 对
+     * @param w 窗口编号，0 为默认窗口
+     * @return false 如果长度非法、与另一个窗口相同（窗口按长度查找，不允许重复）或计数引擎不支持调整
+     */
+    bool setWindowSize(long long newSize, ostream &out, size_t w = 0)
+    {
+        if (newSize <= 0)
         {
-            return -1;
+            out << "窗口大小必须为正数: " << newSize << endl;
+            return false;
         }
-        // 去掉方括号
-        string clean = timeStr.substr(1, timeStr.length() - 2);
-        // 解析时间
-        istringstream iss(clean);
-        int hours = 0, minutes = 0, seconds = 0;
-        char colon1, colon2;
-        if (!(iss >> hours >> colon1 >> minutes >> colon2 >> seconds))
+        if (messages != nullptr)
         {
-            return -1;
+            messages->resize((size_t)newSize, [this](uint32_t id, int count, unsigned long long serial) { shards[0]->decrement(id, count, serial); });
+            out << "窗口大小已调整为最近 " << newSize << " 条消息" << endl;
+            return true;
         }
-        if (colon1 != ':' || colon2 != ':')
+        if (shards[0]->windowed())
         {
-            return -1;
+            out << "当前计数引擎自带固定的时间片窗口，不支持调整窗口大小。" << endl;
+            return false;
         }
-        return hours * 3600 + minutes * 60 + seconds; // 返回总秒数
+        size_t other = findWindow(newSize);
+        if (other != windowSizes.size() && other != w)
+        {
+            out << "已有长度为 " << newSize << " 秒的窗口，未调整。" << endl;
+            return false;
+        }
+        for (counterShard *shard : shards)    shard->quiesce();
+        for (counterShard *shard : shards)    shard->resize(w, newSize);
+        windowSizes[w] = newSize;
+        if (w == 0)    windowSize = newSize;
+        out << "窗口大小已调整为 " << newSize << " 秒";
+        long long retention = shards[0]->retentionSeconds();
+        if (newSize > retention)    out << "（历史数据只保留 " << retention << " 秒）";
+        out << endl;
+        return true;
+    }
+
+    size_t windowCount() const
+    {
+        return windowSizes.size();
+    }
+
+    // 查找长度为 seconds 的窗口编号，不存在时返回 windowSizes.size()
+    size_t findWindow(long long seconds) const
+    {
+        return find(windowSizes.begin(), windowSizes.end(), seconds) - windowSizes.begin();
+    }
+
+    // 处理时间戳函数：支持 [H:MM:SS]、Unix 秒/毫秒和 ISO-8601，详见 timestampParser.cpp
+    long long Timestamp(const string &timeStr)
+    {
+        return ParseTimestamp(timeStr.data(), timeStr.size());
+    }
+
+    // 处理时间戳函数（切片版本，不分配内存）
+    long long Timestamp(const char *data, size_t len)
+    {
+        return ParseTimestamp(data, len);
     }
 
     // 处理带时间戳的句子函数
     string processSentence(const string &sentence, ofstream &out)
+    {
+        return processSentence(sentence.data(), sentence.size(), out);
+    }
+
+    // 处理带时间戳的句子函数（切片版本，用于内存映射输入，不拷贝整行）
+    string processSentence(const char *data, size_t len, ofstream &out)
+    {
+        segment(data, len, scratchLine);
+        return applySegmented(scratchLine, out);
+    }
+
+    /**
+     * 分词阶段：解析时间戳、提取内容并分词
+     * 只读取共享的 jieba，不修改 hotWord 的任何状态，可在多个线程中并发调用
+     * @param result 输出：分词结果（其中的缓冲区可跨句子复用）
+     * @return false 如果时间戳格式错误
+     */
+    bool segment(const char *data, size_t len, segmentedLine &result) const
     {
         // 获取句子时间戳
-        string timestr = sentence.substr(0, sentence.find(']') + 1);
-        long long timestamp = Timestamp(timestr);
-        if (timestamp == -1)
+        const char *bracket = static_cast<const char *>(memchr(data, ']', len));
+        size_t timeLen = bracket ? (size_t)(bracket - data) + 1 : 0;
+        result.timestr.assign(data, timeLen);
+        result.timestamp = ParseTimestamp(data, timeLen);
+        result.words.clear();
+        if (result.timestamp == -1)    return false;
+        // 提取句子内容：复用缓冲区，容量足够时不再分配
+        result.content.assign(data + timeLen, len - timeLen);
+        // 分词
+        jieba->Cut(result.content, result.words, true);
+        return true;
+    }
+
+    /**
+     * 计数阶段：把分词结果应用到计数器和窗口
+     * 必须按输入顺序在同一线程中调用
+     * @return 句子的时间戳字符串；时间戳格式错误时返回空串
+     */
+    string applySegmented(const segmentedLine &line, ofstream &out)
+    {
+        if (line.timestamp == -1)
         {
             out << "时间戳格式错误，跳过该句子处理。" << endl;
-            out << timestr << endl;
+            out << line.timestr << endl;
             return "";
         }
-        // 提取句子内容
-        string content = sentence.substr(sentence.find(']') + 1);
-        // 分词
-        vector<string> words;
-        jieba->Cut(content, words, true);
+        if (bursts != nullptr)    currentTime = line.timestr;
+        if (recycleMin > 0 && internedSinceRecycle >= recycleEvery)    collectSymbols();
+        if (messages != nullptr)    processSentenceByCount(line.words, line.timestamp);
+        else if (enableLateDataHandling)    processSentenceWithLateHandling(line.words, line.timestamp, out);
+        else    processSentenceStandard(line.words, line.timestamp, out);
 
-        if (enableLateDataHandling)    processSentenceWithLateHandling(words, timestamp, out);
-        else    processSentenceStandard(words, timestamp, out);
+        totalSentences++; // 各处理模式都只在这里计数
+        if (snapshotPending)    finishSnapshot(false);
+        if (snapshotInterval > 0 && ++sinceSnapshot >= snapshotInterval)    publishSnapshot(line.timestr);
+        return line.timestr;
+    }
 
-        totalSentences++;
-        return timestr;
+    // 按消息条数计的窗口：整条消息进入窗口，超出条数的最早消息整条移出
+    void processSentenceByCount(const vector<string> &words, long long timestamp)
+    {
+        messageIds.clear();
+        for (const auto &word : words)
+        {
+            uint32_t id = intern(word);
+            // 跳过停用词
+            if (isStopWord[id])    continue;
+            messageIds.push_back(id);
+            shards[0]->increment(id, 1, messages->nextMessage());
+            if (trends != nullptr)    trends->add(id, timestamp);
+            if (snapshotLog != nullptr)    snapshotLog->add(id, timestamp);
+            if (rollups != nullptr)    rollups->add(id, timestamp);
+            totalWords++;
+        }
+        messages->addMessage(messageIds, [this](uint32_t id, int count, unsigned long long serial) { shards[0]->decrement(id, count, serial); });
     }
 
     // 标准处理模式
@@ -176,21 +460,20 @@ public:
     {
         for (const auto &word : words)
         {
+            uint32_t id = intern(word);
             // 跳过停用词
-            if (stopWords.find(word) != stopWords.end())    continue;
-            Counter[word]++;
-            window.push(wordEntry(word, timestamp));
+            if (isStopWord[id])    continue;
+            windowWord(id, timestamp);
+            checkBurst(id, timestamp, out);
             totalWords++;
         }
-        // 移除过期词
-        while (!window.empty() && (timestamp - window.front().timeStamp) > windowSize)
+        // 移除过期词（迟到修正模式下当前时间不因迟到的句子回退）
+        if (retroactiveLate)
         {
-            string oldWord = window.front().word;
-            Counter[oldWord]--;
-            if (Counter[oldWord] <= 0)    Counter.erase(oldWord);
-            window.pop();
+            if (timestamp > latestTimestamp)    latestTimestamp = timestamp;
+            expireWindow(latestTimestamp);
         }
-        totalSentences++;
+        else    expireWindow(timestamp);
 
         return ;
     }
@@ -198,58 +481,418 @@ public:
         // 迟到数据处理模式
     void processSentenceWithLateHandling(const vector<string> &words, long long timestamp, ostream &out)
     {
-        // 1. 将所有词条加入迟到数据处理器
+        // 1. 将整个句子的词条加入迟到数据处理器（同时推进水位线）
+        lateIds.clear();
         for (const auto &word : words)
         {
+            uint32_t id = intern(word);
             // 跳过停用词
-            if (stopWords.find(word) != stopWords.end())    continue;
-            wordEntry entry(word, timestamp);
-            lateDataHandler->addData(entry, out);
+            if (isStopWord[id])    continue;
+            lateIds.push_back(id);
         }
+        lateDataHandler->addData(timestamp, lateIds, out);
 
+        // 2. 按时间戳顺序处理越过水位线的数据：更新计数器和窗口
+        lateDataHandler->getProcessableData(out, [&](long long entryTime, const vector<uint32_t> &ids)
+        {
+            for (uint32_t id : ids)
+            {
+                windowWord(id, entryTime);
+                checkBurst(id, entryTime, out);
+            }
+            totalWords += (long long)ids.size();
+        });
 
-        // 2. 获取所有可处理的数据（按时间戳有序）
-        vector<wordEntry> processableData = lateDataHandler->getProcessableData(out);
+        // 3. 基于水位线移除过期数据
+        expireWindow(lateDataHandler->getWatermark());
+    }
 
-        // 3. 处理有序数据：更新计数器和窗口
-        for (const auto &entry : processableData)
-        {
-            Counter[entry.word]++;
-            window.push(entry);
-            totalWords++;
-        }
+    // 把窗口 w 的前 limit 名读入 topResult，按 RanksBefore 排序
+    // 每个分片各取前 limit 个候选（含与第 limit 名并列的词）再合并：分片的词互不相交，
+    // 全局前 limit 名必在这些候选中，并列时按编号决出，结果与分片数无关
+    void collectTopK(size_t w, size_t limit)
+    {
+        submitPending();
+        topResult.clear();
+        for (counterShard *shard : shards)    shard->topK(w, limit, topResult);
+        sort(topResult.begin(), topResult.end(), RanksBefore);
+        if (topResult.size() > limit)    topResult.resize(limit);
+    }
 
-        // 5. 基于水位线移除过期数据
-        long long currentWatermark = lateDataHandler->getWatermark();
-        while (!window.empty() && (currentWatermark - window.front().timeStamp) > windowSize)
+    // 获取topk热词函数：精确计数时直接从 Stream-Summary 中按计数从大到小读出前 k 个，O(k)
+    // 近似引擎在每项后附上计数的误差上界
+    // @param windowSeconds 查询的窗口长度，0 表示默认窗口
+    void getTopK(int k, ofstream &out, long long windowSeconds = 0)
+    {
+        size_t w = 0;
+        if (windowSeconds > 0)
         {
-            string oldWord = window.front().word;
-            Counter[oldWord]--;
-            if (Counter[oldWord] <= 0)
+            w = findWindow(windowSeconds);
+            if (w == windowSizes.size())
             {
-                Counter.erase(oldWord);
+                out << "没有长度为 " << windowSeconds << " 秒的窗口，可用的窗口：";
+                for (size_t i = 0; i < windowSizes.size(); i++)    out << (i ? ", " : "") << windowSizes[i];
+                out << endl;
+                return;
             }
-            window.pop();
         }
+        collectTopK(w, k > 0 ? (size_t)k : 0);
+
+        out << "当前热词前 " << k << " 名：" << endl;
+        for (size_t i = 0; i < topResult.size(); i++)
+        {
+            out << i + 1 << ". " << symbols.word(topResult[i].id) << " (出现次数: " << topResult[i].count;
+            if (approximateCounting)    out << ", 误差 ≤ " << topResult[i].error;
+            out << ")" << endl;
+        }
+    }
+
+    /**
+     * 启用 Top-K 快照：之后每处理 interval 个句子请求一次默认窗口的前 k 名
+     * 请求不等待分片队列清空，各分片处理到请求处时生成候选，全部就绪后合并发布
+     */
+    void enableSnapshots(size_t k, long long interval)
+    {
+        snapshotK = k;
+        snapshotInterval = interval > 0 ? interval : 1;
     }
 
-    // 获取topk热词函数
-    void getTopK(int k, ofstream &out)
+    // 计数阶段：请求各分片在当前位置生成候选；上一次请求还没发布时先等它（只等到其请求处）
+    void publishSnapshot(const string &asOf)
     {
-        // 使用优先队列获取前 k 个热词
-        priority_queue<wordCount, vector<wordCount>, cmpWordCount> pq;
-        for (const auto &entry : Counter)
+        finishSnapshot(true);
+        snapshotSeq++;
+        for (counterShard *shard : shards)    shard->requestTopK(snapshotK, snapshotSeq);
+        snapshotPending = true;
+        pendingAsOf = asOf;
+        pendingSentences = totalSentences;
+        sinceSnapshot = 0;
+        finishSnapshot(false); // 不分片时候选已经生成
+    }
+
+    /**
+     * 各分片都生成了最近一次请求的候选时，合并（同 collectTopK）并发布快照
+     * @param wait 为 false 时有分片还没处理到请求处就直接返回
+     */
+    void finishSnapshot(bool wait)
+    {
+        if (!snapshotPending)    return;
+        for (counterShard *shard : shards)
+        {
+            if (shard->topKReady(snapshotSeq))    continue;
+            if (!wait)    return;
+            shard->waitTopK(snapshotSeq);
+        }
+        vector<topEntry> candidates;
+        for (counterShard *shard : shards)
+        {
+            const vector<topEntry> &shardTop = shard->publishedTopK();
+            candidates.insert(candidates.end(), shardTop.begin(), shardTop.end());
+        }
+        sort(candidates.begin(), candidates.end(), RanksBefore);
+        if (candidates.size() > snapshotK)    candidates.resize(snapshotK);
+        topKSnapshot *snapshot = new topKSnapshot();
+        snapshot->entries.reserve(candidates.size());
+        for (const topEntry &entry : candidates)
         {
-            pq.push(wordCount(entry.first, entry.second));
+            snapshot->entries.push_back(snapshotEntry{symbols.word(entry.id), entry.count, entry.error});
         }
+        snapshot->asOf = pendingAsOf;
+        snapshot->sentences = pendingSentences;
+        snapshots.publish(snapshot);
+        snapshotPending = false;
+    }
 
-        out << "当前热词前 " << k << " 名：" << endl;
-        for (int i = 0; i < k && !pq.empty(); i++)
+    /**
+     * 读者：从最近发布的快照中读取前 k 名（最多快照中的 snapshotK 名），供嵌入本类的其他线程调用，
+     * 与计数阶段不共享锁；本程序的 ACTION 查询不经过快照，直接查询计数器
+     * @param asOf 输出：快照请求时的时间戳字符串
+     * @return false 如果还没有发布过快照（或并发读者过多）
+     */
+    bool readTopK(size_t k, vector<snapshotEntry> &result, string &asOf)
+    {
+        snapshotPublisher::reader reader = snapshots.acquire();
+        const topKSnapshot *snapshot = reader.get();
+        result.clear();
+        if (snapshot == nullptr)    return false;
+        size_t n = k < snapshot->entries.size() ? k : snapshot->entries.size();
+        result.assign(snapshot->entries.begin(), snapshot->entries.begin() + n);
+        asOf = snapshot->asOf;
+        return true;
+    }
+
+    /**
+     * 启用趋势统计：按 bucketSeconds 分桶，快 EWMA 跨度 span 个桶（慢 EWMA 为 4 倍）
+     */
+    void enableTrend(long long bucketSeconds, int span)
+    {
+        delete trends;
+        trends = new trendTracker(bucketSeconds, span);
+    }
+
+    /**
+     * 启用突发检测：按 bucketSeconds 分桶，基线 EWMA 跨度 span 个桶，
+     * 当前桶至少 minCount 次且 z-score 越过 threshold 时报警
+     */
+    void enableBurstDetection(long long bucketSeconds, int span, double threshold, int minCount, int warmup)
+    {
+        delete bursts;
+        bursts = new burstDetector(bucketSeconds, span, threshold, minCount, warmup);
+    }
+
+    /**
+     * 启用窗口快照日志：每 bucketSeconds 秒一条记录，写入 prefix.log / .idx / .dict，已存在时续写
+     * @return false 如果无法创建日志文件，或已有的日志无法续写（不是快照日志、桶长度不同）
+     */
+    bool enableSnapshotLog(const string &prefix, long long bucketSeconds, size_t indexEvery, ostream &out)
+    {
+        delete snapshotLog;
+        snapshotLog = new snapshotLogWriter();
+        if (!snapshotLog->open(prefix, symbols, bucketSeconds, indexEvery, out))
         {
-            wordCount wc = pq.top();
-            pq.pop();
-            out << i + 1 << ". " << wc.word << " (出现次数: " << wc.count << ")" << endl;
+            out << "无法创建或续写快照日志: " << prefix << endl;
+            delete snapshotLog;
+            snapshotLog = nullptr;
+            return false;
         }
+        return true;
+    }
+
+    /**
+     * 启用分钟 / 小时 / 天汇总，之后可以查询任意历史时间段的 Top-K
+     * @param minuteRetention 分钟汇总保留的分钟数，hourRetention 小时汇总保留的小时数（0 表示一直保留）
+     */
+    void enableRollups(long long minuteRetention = 0, long long hourRetention = 0)
+    {
+        delete rollups;
+        rollups = new timeRollup(minuteRetention, hourRetention);
+    }
+
+    /**
+     * 历史时间段 [from, to) 的前 k 个热词：合并覆盖该时段的分钟 / 小时 / 天汇总
+     * @param from 起始时间（秒，与句子时间戳同一时间轴）
+     */
+    void getTopKInRange(int k, long long from, long long to, ofstream &out)
+    {
+        if (rollups == nullptr)
+        {
+            out << "时间汇总未启用（timeRollups=false）" << endl;
+            return;
+        }
+        if (rangeCounts.size() < symbols.size())    rangeCounts.resize(symbols.size(), 0);
+        vector<uint32_t> touched;
+        size_t merged = rollups->query(from, to, [&](uint32_t id, int count)
+        {
+            if (rangeCounts[id] == 0)    touched.push_back(id);
+            rangeCounts[id] += count;
+        });
+        size_t n = min(touched.size(), (size_t)max(k, 0));
+        partial_sort(touched.begin(), touched.begin() + n, touched.end(), [this](uint32_t a, uint32_t b)
+        {
+            return rangeCounts[a] != rangeCounts[b] ? rangeCounts[a] > rangeCounts[b] : a < b;
+        });
+        out << "该时段热词前 " << k << " 名（合并 " << merged << " 份汇总）：" << endl;
+        for (size_t i = 0; i < n; i++)
+        {
+            out << i + 1 << ". " << symbols.word(touched[i]) << " (出现次数: " << rangeCounts[touched[i]] << ")" << endl;
+        }
+        for (uint32_t id : touched)    rangeCounts[id] = 0;
+    }
+
+    /**
+     * 启用迟到修正模式：不再缓冲和重排，迟到的出现直接并入窗口中其时间所在的桶并立即计入，结果没有额外延迟，
+     * 只有早于所有窗口的出现被丢弃。需要分桶窗口，必须在处理任何输入之前调用
+     * @return false 如果当前计数引擎或窗口策略不支持（此时保持原来的处理方式）
+     */
+    bool enableRetroactiveLateData(ostream &out)
+    {
+        if (messages != nullptr)    return false;
+        if (shards[0]->windowed())
+        {
+            out << "当前计数引擎自带时间片窗口，不支持迟到修正，继续使用重排序缓冲区。" << endl;
+            return false;
+        }
+        delete lateDataHandler;
+        lateDataHandler = nullptr;
+        enableLateDataHandling = false;
+        retroactiveLate = true;
+        for (counterShard *shard : shards)    shard->enableRetroactive();
+        out << "迟到数据直接修正到窗口中的桶（lateDataMode=retroactive），不再缓冲" << endl;
+        return true;
+    }
+
+    /**
+     * 启用自适应允许延迟：重排序缓冲区的实际延迟取观察到的句子延迟的 q 分位数（不超过 allowedLateness）
+     * @return false 如果没有使用重排序缓冲区
+     */
+    bool enableAdaptiveLateness(double q, ostream &out)
+    {
+        if (lateDataHandler == nullptr)    return false;
+        lateDataHandler->enableAdaptiveLateness(q, out);
+        return true;
+    }
+
+    // 检查点中记录的配置：恢复时必须一致，否则各部分的状态无法对应
+    // 迟到数据的处理方式：0 不处理，1 重排序缓冲区，2 迟到修正
+    char lateMode() const
+    {
+        return enableLateDataHandling ? 1 : retroactiveLate ? 2 : 0;
+    }
+
+    void putCheckpointLayout(checkpointWriter &writer) const
+    {
+        writer.put<uint32_t>((uint32_t)shards.size());
+        writer.put<uint32_t>((uint32_t)windowSizes.size());
+        writer.put<char>(messages != nullptr);
+        writer.put<char>(lateMode());
+        writer.put<char>(trends != nullptr);
+        writer.put<char>(bursts != nullptr);
+        writer.put<char>(rollups != nullptr);
+    }
+
+    /**
+     * 把完整状态写入检查点文件：符号表、各分片的窗口桶、按条数窗口、迟到缓冲区与水位线、
+     * 趋势、突发检测与时间汇总的状态、统计量，以及调用方的输入进度
+     * 精确计数器不单独保存，恢复时由窗口中的桶重新计入；近似引擎的计数器按值保存
+     * @param linesApplied 已处理的输入行数（恢复后跳过这么多行）
+     * @param currTime 最近一个句子的时间戳字符串
+     */
+    bool saveCheckpoint(const string &path, const checkpointInput &input, const string &currTime, ostream &out)
+    {
+        if (shards[0]->windowed())
+        {
+            out << "当前计数引擎自带时间片窗口，不支持检查点。" << endl;
+            return false;
+        }
+        for (counterShard *shard : shards)    shard->quiesce(); // 待提交的出现随窗口保存，不提前提交
+        checkpointWriter writer;
+        putCheckpointLayout(writer);
+        input.save(writer);
+        writer.putString(currTime);
+        writer.put(totalWords);
+        writer.put(totalSentences);
+        writer.put(latestTimestamp);
+        writer.putVector(windowSizes);
+
+        symbols.save(writer);
+        writer.put((uint64_t)recycleEvery);
+        writer.put((uint64_t)internedSinceRecycle);
+        writer.put(recycleRounds);
+        writer.put(recycledIds);
+
+        for (counterShard *shard : shards)    shard->save(writer);
+        if (messages != nullptr)    messages->save(writer);
+        if (lateDataHandler != nullptr)    lateDataHandler->save(writer);
+        if (trends != nullptr)    trends->save(writer);
+        if (bursts != nullptr)    bursts->save(writer);
+        if (rollups != nullptr)    rollups->save(writer);
+
+        if (!writer.writeFile(path))
+        {
+            out << "无法写入检查点: " << path << endl;
+            return false;
+        }
+        out << "检查点已写入 " << path << "（" << writer.size() << " 字节，" << symbols.liveCount() << " 个词）" << endl;
+        return true;
+    }
+
+    /**
+     * 从检查点恢复完整状态，只能在处理任何输入之前调用
+     * @param input 输出：检查点对应的输入（路径、文件标识、已处理的行数及其指纹）
+     * @param currTime 输出：检查点时最近一个句子的时间戳字符串
+     * @param accept accept(input) 在修改任何状态之前确认检查点对应的输入与当前输入一致，返回 false 时跳过检查点
+     * @return CheckpointSkipped 如果文件不存在、与当前配置或输入不符，状态未被修改，可以从头开始；
+     *         CheckpointCorrupt 如果恢复到一半发现数据不完整，此时状态已不可用
+     */
+    template <class Accept>
+    checkpointStatus loadCheckpoint(const string &path, checkpointInput &input, string &currTime, ostream &out, Accept &&accept)
+    {
+        checkpointReader reader;
+        if (!reader.readFile(path))    return CheckpointSkipped;
+        uint32_t shardCount, windowCount;
+        char hasMessages, hasLate, hasTrends, hasBursts, hasRollups;
+        if (!reader.get(shardCount) || !reader.get(windowCount) || !reader.get(hasMessages) || !reader.get(hasLate)
+            || !reader.get(hasTrends) || !reader.get(hasBursts) || !reader.get(hasRollups))
+        {
+            out << "检查点不完整，忽略检查点: " << path << endl;
+            return CheckpointSkipped;
+        }
+        if (shards[0]->windowed() || shardCount != shards.size() || windowCount != windowSizes.size()
+            || (hasMessages != 0) != (messages != nullptr) || hasLate != lateMode()
+            || (hasTrends != 0) != (trends != nullptr) || (hasBursts != 0) != (bursts != nullptr)
+            || (hasRollups != 0) != (rollups != nullptr))
+        {
+            out << "检查点的配置（分片数、窗口数或启用的功能）与当前配置不符，忽略检查点: " << path << endl;
+            return CheckpointSkipped;
+        }
+        if (!input.load(reader))
+        {
+            out << "检查点不完整，忽略检查点: " << path << endl;
+            return CheckpointSkipped;
+        }
+        if (!accept(input))    return CheckpointSkipped;
+
+        vector<long long> sizes;
+        uint64_t savedEvery, savedSince;
+        bool ok = reader.getString(currTime) && reader.get(totalWords) && reader.get(totalSentences)
+            && reader.get(latestTimestamp) && reader.getVector(sizes) && sizes.size() == windowSizes.size();
+        ok = ok && symbols.load(reader, [this](uint32_t id, const string &word)
+        {
+            if (id >= isStopWord.size())    isStopWord.resize(id + 1, 0);
+            isStopWord[id] = stopWords.count(word) ? 1 : 0;
+        });
+        ok = ok && reader.get(savedEvery) && reader.get(savedSince) && reader.get(recycleRounds) && reader.get(recycledIds);
+        if (ok && recycleMin > 0)    recycleEvery = max(recycleMin, (size_t)savedEvery);
+        if (ok)    internedSinceRecycle = (size_t)savedSince;
+        for (size_t i = 0; ok && i < shards.size(); i++)    ok = shards[i]->load(reader);
+        if (ok && messages != nullptr)    ok = messages->load(reader, [this](uint32_t id, int count, unsigned long long serial) { shards[0]->increment(id, count, serial); });
+        if (ok && lateDataHandler != nullptr)    ok = lateDataHandler->load(reader);
+        if (ok && trends != nullptr)    ok = trends->load(reader);
+        if (ok && bursts != nullptr)    ok = bursts->load(reader);
+        if (ok && rollups != nullptr)    ok = rollups->load(reader);
+        if (!ok)
+        {
+            out << "检查点不完整或与当前配置不符: " << path << endl;
+            return CheckpointCorrupt;
+        }
+        windowSizes = sizes;
+        windowSize = sizes[0];
+        out << "已从检查点恢复 " << path << "：" << symbols.liveCount() << " 个词，已处理 " << input.lines << " 行" << endl;
+        return CheckpointRestored;
+    }
+
+    // 变化最快的词：上升最快和下降最快的各 k 个（以最近结束的桶为准）
+    void getTrend(int k, ofstream &out)
+    {
+        if (trends == nullptr)
+        {
+            out << "趋势统计未启用（trendBucketSeconds=0）" << endl;
+            return;
+        }
+        vector<trendEntry> rising, falling;
+        trends->query(k > 0 ? (size_t)k : 0, rising, falling);
+        out << fixed << setprecision(2);
+        out << "上升最快的词（每 " << trends->bucketLength() << " 秒的次数变化）：" << endl;
+        for (size_t i = 0; i < rising.size(); i++)
+        {
+            out << i + 1 << ". " << symbols.word(rising[i].id) << " (斜率: +" << rising[i].slope
+                << ", 当前: " << rising[i].level << ")" << endl;
+        }
+        out << "下降最快的词：" << endl;
+        for (size_t i = 0; i < falling.size(); i++)
+        {
+            out << i + 1 << ". " << symbols.word(falling[i].id) << " (斜率: " << falling[i].slope
+                << ", 当前: " << falling[i].level << ")" << endl;
+        }
+        out << defaultfloat << setprecision(6);
+    }
+
+    // 窗口 w 中计数大于 0 的词数（各分片之和）
+    size_t distinctWords(size_t w) const
+    {
+        size_t total = 0;
+        for (const counterShard *shard : shards)    total += shard->size(w);
+        return total;
     }
 
     // 统计信息函数
@@ -257,7 +900,45 @@ public:
     {
         out << "总处理句子数: " << totalSentences << endl;
         out << "总处理词数: " << totalWords << endl;
-        out << "当前不同词数: " << Counter.size() << endl;
+        submitPending();
+        out << "当前不同词数: " << distinctWords(0) << endl;
+        for (size_t w = 1; w < windowSizes.size(); w++)
+        {
+            out << "窗口 " << windowSizes[w] << " 秒不同词数: " << distinctWords(w) << endl;
+        }
+        if (messages != nullptr)
+        {
+            out << "窗口内消息数: " << messages->messages() << " / " << messages->windowMessages()
+                << "，词数: " << messages->tokensInWindow() << endl;
+        }
+        if (shards.size() > 1)    out << "计数分片数: " << shards.size() << "（每个分片各自的计数引擎）" << endl;
+        shards[0]->printStats(out);
+        if (snapshotLog != nullptr)
+        {
+            snapshotLog->finish();
+            out << "本次写入快照日志记录数: " << snapshotLog->recordCount() << endl;
+        }
+        if (retroactiveLate)
+        {
+            long long merged = 0, dropped = 0;
+            for (const counterShard *shard : shards)
+            {
+                merged += shard->lateMergedCount();
+                dropped += shard->lateDroppedCount();
+            }
+            out << "迟到修正: " << merged << " 次并入窗口中的桶，" << dropped << " 次因早于所有窗口而丢弃" << endl;
+        }
+        if (rollups != nullptr)
+        {
+            out << "时间汇总: " << rollups->minuteCount() << " 份分钟汇总，" << rollups->hourCount() << " 份小时汇总，"
+                << rollups->dayCount() << " 份天汇总" << endl;
+        }
+        if (recycleRounds > 0)
+        {
+            out << "词编号回收: " << recycleRounds << " 次，共回收 " << recycledIds << " 个编号，编号上界 " << symbols.size()
+                << "，在用 " << symbols.liveCount() << " 个" << endl;
+        }
+        if (bursts != nullptr)    out << "突发报警数: " << bursts->alertCount() << "（每 " << bursts->bucketLength() << " 秒一桶）" << endl;
                 
         // 如果启用了迟到数据处理，打印相关统计
         if (enableLateDataHandling && lateDataHandler != nullptr)
@@ -272,24 +953,31 @@ public:
     {
         if (enableLateDataHandling && lateDataHandler != nullptr)
         {
-            // 强制清空缓冲区并获取所有数据
-            vector<wordEntry> remainingData = lateDataHandler->forceFlush(out);
-            
-            // 处理所有剩余数据
-            for (const auto &entry : remainingData)
+            // 强制清空缓冲区，按时间顺序处理所有剩余数据
+            size_t remaining = lateDataHandler->forceFlush(out, [&](long long entryTime, const vector<uint32_t> &ids)
             {
-                Counter[entry.word]++;
-                window.push(entry);
-                totalWords++;
-            }
+                for (uint32_t id : ids)
+                {
+                    windowWord(id, entryTime);
+                    checkBurst(id, entryTime, out);
+                }
+                totalWords += (long long)ids.size();
+            });
             
-            out << "缓冲区已清空，处理了 " << remainingData.size() << " 条数据。" << endl;
+            out << "缓冲区已清空，处理了 " << remaining << " 条数据。" << endl;
         }
     }
 
     ~hotWord()
     {
         delete jieba;
+        delete messages;
+        delete trends;
+        delete bursts;
+        delete rollups;
+        if (snapshotLog != nullptr)    snapshotLog->finish();
+        delete snapshotLog;
+        for (counterShard *shard : shards)    delete shard;
         if (lateDataHandler != nullptr)    delete lateDataHandler;
     }
 };
\ No newline at end of file
@@ -0,0 +1,395 @@
+#ifndef INPUT_READER_CPP
+#define INPUT_READER_CPP
+
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <cstring>
+#include <csignal>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <cerrno>
+#include <vector>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+using namespace std;
+
+/**
+ * 流式读取 UTF-8 输入
+ *
+ * 每读到一行就立即交给 handler 处理，不在内存中保留整个文件：
+ * - 内存占用只与滑动窗口有关，与输入文件大小无关
+ * - 首个 Top-K 结果无需等待整个文件读完
+ *
+ * @param in 输入流
+ * @param handler 行处理函数，签名为 void(const string &line)
+ * @return 处理的非空行数
+ */
+template<typename Handler>
+long long StreamUtf8Lines(istream &in, Handler &&handler)
+{
+    string line; // 复用同一缓冲区，避免每行重新分配
+    long long lineCount = 0;
+    while (getline(in, line))
+    {
+        // 去掉 Windows 换行符中的 \r
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty())    continue;
+        handler(line);
+        lineCount++;
+    }
+    return lineCount;
+}
+
+// 输入行指纹的初值：逐行累积的 FNV-1a，行与行之间以 '\n' 分隔
+const uint64_t INPUT_HASH_SEED = 14695981039346656037ULL;
+
+inline uint64_t InputLineHash(uint64_t hash, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    hash ^= (unsigned char)'\n';
+    hash *= 1099511628211ULL;
+    return hash;
+}
+
+/**
+ * 计算输入文件前 lines 个非空行的指纹（与 StreamUtf8Lines 相同地去掉 \r、跳过空行），
+ * 用于确认检查点对应的输入前缀，只读到第 lines 行为止
+ * @return false 如果文件无法打开或不足 lines 行
+ */
+inline bool HashInputPrefix(const string &filename, long long lines, uint64_t &hash)
+{
+    ifstream in(filename, ios::binary);
+    if (!in.is_open())    return false;
+    hash = INPUT_HASH_SEED;
+    string line;
+    long long seen = 0;
+    while (seen < lines && getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')    line.pop_back();
+        if (line.empty())    continue;
+        hash = InputLineHash(hash, line.data(), line.size());
+        seen++;
+    }
+    return seen == lines;
+}
+
+/**
+ * 输入文件的设备号、inode 和大小，用于识别检查点对应的文件
+ * @return false 如果无法获取或不是普通文件（标准输入、管道）
+ */
+inline bool StatInputFile(const string &filename, uint64_t &device, uint64_t &inode, uint64_t &size)
+{
+#ifdef _WIN32
+    (void)filename;
+    device = inode = size = 0;
+    return false;
+#else
+    struct stat st;
+    if (filename == "-" || stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        device = inode = size = 0;
+        return false;
+    }
+    device = (uint64_t)st.st_dev;
+    inode = (uint64_t)st.st_ino;
+    size = (uint64_t)st.st_size;
+    return true;
+#endif
+}
+
+/**
+ * 内存映射方式读取 UTF-8 输入（零拷贝）
+ *
+ * 将整个文件只读映射到内存，用 memchr 查找换行符（glibc 中为 SIMD 向量化实现），
+ * 把每一行以 (指针, 长度) 的切片形式交给 handler，行内容不会被拷贝到 std::string。
+ * 适合重放已归档的大文件；映射的页面由内核按需换入换出，不占用进程堆内存。
+ *
+ * @param filename 输入文件路径
+ * @param handler 行处理函数，签名为 void(const char *data, size_t len)
+ * @param lineCount 输出：处理的非空行数
+ * @return false 如果文件无法打开或映射（Windows 下始终返回 false，由调用方回退到流式读取）
+ */
+template<typename Handler>
+bool MapUtf8Lines(const string &filename, Handler &&handler, long long &lineCount)
+{
+    lineCount = 0;
+#ifdef _WIN32
+    (void)filename;
+    (void)handler;
+    return false;
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)    return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    size_t fileSize = (size_t)st.st_size;
+    if (fileSize == 0) // 空文件无法映射，直接返回
+    {
+        close(fd);
+        return true;
+    }
+    void *mapped = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // 映射建立后即可关闭文件描述符
+    if (mapped == MAP_FAILED)    return false;
+    madvise(mapped, fileSize, MADV_SEQUENTIAL); // 顺序读取，提示内核预读
+
+    const char *pos = static_cast<const char *>(mapped);
+    const char *end = pos + fileSize;
+    while (pos < end)
+    {
+        const char *newline = static_cast<const char *>(memchr(pos, '\n', end - pos));
+        const char *lineEnd = newline ? newline : end;
+        size_t len = lineEnd - pos;
+        // 去掉 Windows 换行符中的 \r
+        if (len > 0 && pos[len - 1] == '\r')    len--;
+        if (len > 0)
+        {
+            handler(pos, len);
+            lineCount++;
+        }
+        pos = lineEnd + 1;
+    }
+    munmap(mapped, fileSize);
+    return true;
+#endif
+}
+
+// 实时模式的停止标志：收到 SIGINT/SIGTERM 后置位，读取循环随即退出
+volatile sig_atomic_t g_stopRequested = 0;
+
+#ifndef _WIN32
+void RequestStop(int)
+{
+    g_stopRequested = 1;
+}
+
+// 安装停止信号处理函数（不设置 SA_RESTART，使阻塞的 open/read/poll 能被信号打断）
+void InstallStopHandler()
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = RequestStop;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+}
+
+/**
+ * 等待文件出现新数据（tail -f 语义）
+ * Linux 下使用 inotify 监听修改事件，其他平台退化为定时轮询；
+ * 每次最多等待 waitMs 毫秒，以便及时响应停止信号。
+ * @return false 如果文件被删除或移走（需要重新打开）
+ */
+bool WaitForGrowth(int inotifyFd, int waitMs)
+{
+#ifdef __linux__
+    if (inotifyFd >= 0)
+    {
+        struct pollfd pfd;
+        pfd.fd = inotifyFd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, waitMs) <= 0)    return true;
+        char events[4096];
+        ssize_t n = read(inotifyFd, events, sizeof(events));
+        for (ssize_t off = 0; off < n;)
+        {
+            const struct inotify_event *ev = reinterpret_cast<const struct inotify_event *>(events + off);
+            if (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF))    return false;
+            off += sizeof(struct inotify_event) + ev->len;
+        }
+        return true;
+    }
+#endif
+    (void)inotifyFd;
+    usleep(waitMs * 1000);
+    return true;
+}
+#endif
+
+/**
+ * 实时读取 UTF-8 输入：标准输入、命名管道或持续增长的文件
+ *
+ * - path 为 "-" 时读取标准输入，读到 EOF 结束
+ * - 命名管道：写端关闭后重新打开，等待下一个写入者（采集进程重启不会导致本进程退出）
+ * - 普通文件：读到末尾后等待追加（tail -f），文件被截断时从头读起，被轮转时重新打开
+ * 除标准输入外，只有收到 SIGINT/SIGTERM 才会结束。hotWord 的窗口状态在整个过程中保持。
+ *
+ * @param path 输入路径
+ * @param handler 行处理函数，签名为 void(const char *data, size_t len)
+ * @param onIdle 空闲回调，每次等待新数据之前调用（例如刷新输出）
+ * @param lineCount 输出：处理的非空行数
+ * @return false 如果输入无法打开（Windows 下不支持，始终返回 false）
+ */
+template<typename Handler, typename IdleHandler>
+bool FollowUtf8Lines(const string &path, Handler &&handler, IdleHandler &&onIdle, long long &lineCount)
+{
+    lineCount = 0;
+#ifdef _WIN32
+    (void)path;
+    (void)handler;
+    (void)onIdle;
+    return false;
+#else
+    const bool isStdin = (path == "-");
+    int fd = isStdin ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+    if (fd < 0)    return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        if (!isStdin)    close(fd);
+        return false;
+    }
+    const bool isFifo = S_ISFIFO(st.st_mode);
+    const bool isRegular = !isStdin && S_ISREG(st.st_mode);
+
+    int inotifyFd = -1;
+#ifdef __linux__
+    if (isRegular)
+    {
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd >= 0 && inotify_add_watch(inotifyFd, path.c_str(), IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF) < 0)
+        {
+            close(inotifyFd);
+            inotifyFd = -1;
+        }
+    }
+#endif
+
+    // 行缓冲区：保存尚未读到换行符的半行
+    vector<char> buffer(1 << 16);
+    size_t used = 0;
+    off_t offset = 0;
+    bool rotated = false;
+    auto emitLine = [&](const char *data, size_t len)
+    {
+        if (len > 0 && data[len - 1] == '\r')    len--;
+        if (len == 0)    return;
+        handler(data, len);
+        lineCount++;
+    };
+
+    while (!g_stopRequested)
+    {
+        if (used == buffer.size())    buffer.resize(buffer.size() * 2); // 超长行
+        ssize_t n = read(fd, buffer.data() + used, buffer.size() - used);
+        if (n < 0)
+        {
+            if (errno == EINTR)    continue;
+            break;
+        }
+        if (n > 0)
+        {
+            offset += n;
+            // 交付所有完整的行，剩余半行移到缓冲区开头
+            const char *begin = buffer.data();
+            const char *pos = begin + used;
+            const char *end = begin + used + n;
+            const char *lineStart = begin;
+            const char *newline;
+            while ((newline = static_cast<const char *>(memchr(pos, '\n', end - pos))) != NULL)
+            {
+                emitLine(lineStart, newline - lineStart);
+                lineStart = pos = newline + 1;
+            }
+            used = end - lineStart;
+            memmove(buffer.data(), lineStart, used);
+            continue;
+        }
+
+        // n == 0：到达当前末尾
+        if (isStdin || isFifo)
+        {
+            // 写端已关闭：最后一行可能没有换行符
+            if (used > 0)    emitLine(buffer.data(), used);
+            used = 0;
+        }
+        if (isStdin)    break;
+        onIdle();
+        if (isFifo)
+        {
+            // 重新打开，等待下一个写入者
+            close(fd);
+            fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)    break;
+            continue;
+        }
+        if (rotated)
+        {
+            // 文件被轮转，旧文件已读到末尾：等同名新文件出现后重新打开（在此之前继续读旧文件，
+            // 仍持有旧文件的写入者追加的内容不会丢）
+            int newFd = open(path.c_str(), O_RDONLY);
+            if (newFd < 0)
+            {
+                usleep(500 * 1000);
+                continue;
+            }
+            // 旧文件最后一行没有换行符：写入者已经换到新文件，作为完整的一行交付，不与新文件的第一行拼接
+            if (used > 0)    emitLine(buffer.data(), used);
+            used = 0;
+            close(fd);
+            fd = newFd;
+            offset = 0;
+            rotated = false;
+            fstat(fd, &st);
+#ifdef __linux__
+            if (inotifyFd >= 0)
+            {
+                close(inotifyFd);
+                inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+                if (inotifyFd >= 0)    inotify_add_watch(inotifyFd, path.c_str(), IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF);
+            }
+#endif
+            continue;
+        }
+        if (!WaitForGrowth(inotifyFd, 500))
+        {
+            // 收到移走/删除事件：先回到循环开头把旧文件读到末尾，再切换到新文件
+            rotated = true;
+            continue;
+        }
+        struct stat current;
+        if (isRegular && (stat(path.c_str(), &current) != 0 || current.st_ino != st.st_ino || current.st_dev != st.st_dev))
+        {
+            // 没有 inotify 时靠路径指向的文件变了发现轮转，同样先读完旧文件
+            rotated = true;
+            continue;
+        }
+        if (isRegular && fstat(fd, &st) == 0 && st.st_size < offset)
+        {
+            // 文件被截断：从头开始读，截断前未读完的半行丢弃
+            lseek(fd, 0, SEEK_SET);
+            offset = 0;
+            used = 0;
+        }
+    }
+    onIdle();
+
+    if (!isStdin && fd >= 0)    close(fd);
+    if (inotifyFd >= 0)    close(inotifyFd);
+    return true;
+#endif
+}
+
+#endif // INPUT_READER_CPP
@@ -1,59 +1,76 @@
 #ifndef LATE_DATA_HANDLER_CPP
 #define LATE_DATA_HANDLER_CPP
 
-#include <queue>
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <iostream>
+#include "delayHistogram.cpp"
 
 using namespace std;
 
-// wordEntry 结构需要在这里完整定义（从 hotWord.cpp 移动到这里）
-// 但为了避免循环依赖，我们在 hotWord.cpp 中定义后再包含此文件
-
-// 时间戳比较器：用于优先队列的排序
-// 小顶堆：时间戳小的元素优先级高（先出队）
-template<typename T>
-class CompareTimestamp
-{
-public:
-    bool operator()(const T &a, const T &b) const
-    {
-        return a.timeStamp > b.timeStamp; // 时间戳小的优先
-    }
-};
-
 /**
  * 迟到/乱序数据处理器
- * 
+ *
  * 功能：
- * 1. 接收乱序到达的数据
- * 2. 使用优先队列按时间戳排序
+ * 1. 接收乱序到达的数据（以句子为单位：一个时间戳和该句的一组条目，如词编号）
+ * 2. 按秒放入环形的重排序缓冲区
  * 3. 通过水位线机制确定哪些数据可以安全处理
  * 4. 提供有序的数据流供下游处理
- * 
+ *
  * 核心概念：
- * - 水位线（Watermark）：表示"早于此时间的数据都已到达"的时间戳
+ * - 水位线（Watermark）：表示"早于此时间的数据都已到达"的时间戳，每次见到更大的时间戳时推进
  * - 允许延迟（Allowed Lateness）：系统能容忍的最大数据延迟
- * - 排序缓冲区（Ordered Buffer）：暂存乱序数据的优先队列
+ * - 重排序缓冲区：每秒一个槽位的环形数组（槽位数为不小于 allowedLateness + 2 的 2 的幂），
+ *   缓冲区中的时间戳总在 (水位线, 水位线 + allowedLateness] 内，互不冲突；
+ *   加入一个句子 O(1)（追加到所在秒的槽位），水位线越过某秒时把整个槽位交换到待处理列表
+ * - 时间戳不晚于水位线、但在允许延迟内的数据直接进入待处理列表，更早的数据丢弃
+ * - 自适应允许延迟（可选）：每个句子的延迟（最大观察时间戳 - 句子时间戳）记入延迟直方图，
+ *   每 TUNE_EVERY 个句子把实际使用的延迟调整为延迟分布的指定分位数（如 p99.9），上限为 allowedLateness
  */
 template<typename T>
 class LateDataHandler
 {
+public:
+    // 同一秒的一批数据
+    struct batch
+    {
+        long long timeStamp = 0;
+        vector<T> items;
+    };
+
 private:
-    // 排序缓冲区：按时间戳从小到大排序
-    priority_queue<T, vector<T>, CompareTimestamp<T>> orderedBuffer;
+    // 重排序缓冲区：槽位 s & mask 保存时间戳为 s 的数据（s 在 (水位线, 水位线 + 槽位数] 内），空槽位的时间戳无意义
+    vector<batch> ring;
+    size_t mask;
+
+    // 待处理列表：已越过水位线、按时间戳从小到大排列的批次（前 readyCount 个有效，复用容量）
+    vector<batch> ready;
+    size_t readyCount = 0;
 
     // 当前水位线：表示已处理到的时间点
     long long watermark;
 
-    // 允许的最大延迟时间（秒）
+    // 允许的最大延迟时间（秒），决定槽位数；自适应时是实际延迟的上限
     long long allowedLateness;
 
+    // 实际使用的延迟（秒）：固定时等于 allowedLateness，自适应时在 [0, allowedLateness] 内
+    long long lateness;
+
+    // 自适应允许延迟：延迟分布、目标分位数和调整记录
+    enum { TUNE_EVERY = 256, MIN_SAMPLES = 1024 };
+    bool adaptive = false;
+    double quantile = 0.999;
+    delayHistogram delays;
+    uint64_t sinceTune = 0;
+    long long adjustments = 0;
+    long long lowestLateness, highestLateness;
+
     // 观察到的最大时间戳
     long long maxObservedTimestamp;
 
-    // 缓冲区最大容量（避免内存无限增长）
+    // 缓冲区最大容量（条目数，避免内存无限增长）
     size_t maxBufferSize;
 
     // 统计信息
@@ -61,6 +78,66 @@ private:
     long long totalDropped;      // 丢弃的迟到数据数
     long long totalBuffered;     // 当前缓冲区中的数据数
 
+    // 时间戳为 timeStamp 的批次：已有则返回，否则按时间顺序插入待处理列表
+    // 迟到的数据通常只比列表末尾早几秒，从末尾向前查找，移动的是批次而不是其中的条目
+    vector<T> &readyBatch(long long timeStamp)
+    {
+        size_t pos = readyCount;
+        while (pos > 0 && ready[pos - 1].timeStamp > timeStamp)    pos--;
+        if (pos > 0 && ready[pos - 1].timeStamp == timeStamp)    return ready[pos - 1].items;
+        if (readyCount == ready.size())    ready.push_back(batch());
+        // 把末尾的空闲批次轮换到 pos
+        rotate(ready.begin() + pos, ready.begin() + readyCount, ready.begin() + readyCount + 1);
+        readyCount++;
+        batch &b = ready[pos];
+        b.timeStamp = timeStamp;
+        b.items.clear();
+        return b.items;
+    }
+
+    // 把水位线推进到 newWatermark，越过的秒整槽交换到待处理列表
+    // 缓冲区中的时间戳都在 (watermark, watermark + 槽位数] 内，最多检查一圈槽位
+    void advance(long long newWatermark)
+    {
+        if (newWatermark <= watermark)    return;
+        long long last = newWatermark - watermark > (long long)ring.size() ? watermark + (long long)ring.size() : newWatermark;
+        for (long long s = watermark + 1; s <= last && totalBuffered > 0; s++)
+        {
+            batch &slot = ring[(size_t)s & mask];
+            if (slot.items.empty())    continue;
+            if (readyCount == ready.size())    ready.push_back(batch());
+            batch &b = ready[readyCount++];
+            b.timeStamp = s;
+            b.items.clear();
+            b.items.swap(slot.items);
+            totalBuffered -= (long long)b.items.size();
+        }
+        watermark = newWatermark;
+    }
+
+    // 缓冲区超过容量时提前推进水位线，释放最早的秒，直到低于容量
+    void shrink(ostream &out)
+    {
+        if ((size_t)totalBuffered <= maxBufferSize)    return;
+        out << "[警告] 缓冲区已满，强制推进水位线" << endl;
+        while ((size_t)totalBuffered > maxBufferSize)    advance(watermark + 1);
+    }
+
+    // 把实际延迟调整为延迟分布的目标分位数；调小时水位线随之推进，调大时水位线不后退
+    void tune()
+    {
+        sinceTune = 0;
+        if (delays.size() < MIN_SAMPLES)    return;
+        long long target = delays.quantile(quantile);
+        if (target > allowedLateness)    target = allowedLateness;
+        if (target == lateness)    return;
+        lateness = target;
+        adjustments++;
+        if (target < lowestLateness)    lowestLateness = target;
+        if (target > highestLateness)    highestLateness = target;
+        updateWatermark();
+    }
+
 public:
     /**
      * 构造函数
@@ -68,126 +145,148 @@ public:
      * @param maxBufferSize 缓冲区最大容量
      * @param out 输出流（用于日志）
      */
-    LateDataHandler(long long allowedLateness = 30, 
+    LateDataHandler(long long allowedLateness = 30,
                     size_t maxBufferSize = 10000,
                     ostream &out = cout)
-        : allowedLateness(allowedLateness),
-          maxBufferSize(maxBufferSize),
-          watermark(-1000000),  // 初始化为很小的值，以便处理早期数据
+        : watermark(-1000000),  // 初始化为很小的值，以便处理早期数据
+          allowedLateness(allowedLateness > 0 ? allowedLateness : 0),
+          lateness(this->allowedLateness),
           maxObservedTimestamp(0),
+          maxBufferSize(maxBufferSize),
           totalProcessed(0),
           totalDropped(0),
           totalBuffered(0)
     {
+        lowestLateness = highestLateness = lateness;
+        size_t slots = 1;
+        while (slots < (size_t)this->allowedLateness + 2)    slots <<= 1;
+        ring.resize(slots);
+        mask = slots - 1;
         out << "=== 迟到/乱序数据处理器初始化 ===" << endl;
         out << "允许最大延迟: " << allowedLateness << " 秒" << endl;
         out << "缓冲区最大容量: " << maxBufferSize << " 条" << endl;
     }
 
     /**
-     * 添加数据到缓冲区
-     * @param entry 数据条目（包含词和时间戳）
+     * 启用自适应允许延迟：实际延迟取观察到的延迟分布的 q 分位数，不超过 allowedLateness
+     * 样本不足 MIN_SAMPLES 个句子时保持 allowedLateness
+     * @param q 目标分位数（0 ~ 1，如 0.999）
+     */
+    void enableAdaptiveLateness(double q, ostream &out)
+    {
+        adaptive = true;
+        quantile = q > 0 && q <= 1 ? q : 0.999;
+        out << "自适应允许延迟: 取延迟分布的 " << quantile * 100 << "% 分位数，上限 " << allowedLateness << " 秒" << endl;
+    }
+
+    /**
+     * 添加一个句子的数据到缓冲区：见到更大的时间戳时先推进水位线，O(1) + 复制条目
+     * @param timeStamp 句子的时间戳
+     * @param items 句子中的条目（如非停用词的编号）
      * @param out 输出流
      * @return true 如果成功添加，false 如果被丢弃
      */
-    bool addData(const T &entry, ostream &out)
+    bool addData(long long timeStamp, const vector<T> &items, ostream &out)
     {
-        // 更新最大观察时间戳
-        if (entry.timeStamp > maxObservedTimestamp)
+        if (items.empty())    return true;
+        // 记录延迟，自适应时定期调整实际延迟
+        delays.add(maxObservedTimestamp - timeStamp);
+        if (adaptive && ++sinceTune >= TUNE_EVERY)    tune();
+
+        // 更新最大观察时间戳，并随之推进水位线
+        if (timeStamp > maxObservedTimestamp)
         {
-            maxObservedTimestamp = entry.timeStamp;
+            maxObservedTimestamp = timeStamp;
+            updateWatermark();
         }
 
-        // 检查数据是否过于迟到（早于当前水位线 - 窗口大小）
+        // 检查数据是否过于迟到（早于当前水位线 - 允许延迟）
         // 这些数据已经无法影响结果，直接丢弃
-        if (entry.timeStamp < watermark - allowedLateness)
+        if (timeStamp < watermark - lateness)
         {
-            totalDropped++;
-            out << "[警告] 数据过于迟到，已丢弃。时间戳: " << entry.timeStamp 
+            totalDropped += (long long)items.size();
+            out << "[警告] 数据过于迟到，已丢弃。时间戳: " << timeStamp
                 << ", 当前水位线: " << watermark << endl;
             return false;
         }
 
-        // 检查缓冲区是否已满
-        if (orderedBuffer.size() >= maxBufferSize)
+        // 已越过水位线但仍在允许延迟内：直接进入待处理列表
+        if (timeStamp <= watermark)
         {
-            out << "[警告] 缓冲区已满，强制推进水位线" << endl;
-            // 强制推进水位线，释放一些数据
-            forceFlush(out);
+            vector<T> &target = readyBatch(timeStamp);
+            target.insert(target.end(), items.begin(), items.end());
+            return true;
         }
 
-        // 添加到缓冲区
-        orderedBuffer.push(entry);
-        totalBuffered++;
+        // 添加到所在秒的槽位
+        batch &slot = ring[(size_t)timeStamp & mask];
+        slot.timeStamp = timeStamp;
+        slot.items.insert(slot.items.end(), items.begin(), items.end());
+        totalBuffered += (long long)items.size();
+        shrink(out);
         return true;
     }
 
     /**
      * 更新水位线
-     * 水位线 = 最大观察时间戳 - 允许延迟
+     * 水位线 = 最大观察时间戳 - 实际延迟
      * 表示：所有小于等于水位线的数据都已到达（或不再等待）
      */
     void updateWatermark()
     {
-        long long newWatermark = maxObservedTimestamp - allowedLateness;
         // 允许水位线为负值（在数据刚开始流入时）
-        if (newWatermark > watermark)
-        {
-            watermark = newWatermark;
-        }
+        advance(maxObservedTimestamp - lateness);
     }
 
     /**
-     * 获取所有可处理的数据（时间戳 <= 水位线）
+     * 按时间戳从小到大取出所有可处理的数据（时间戳 <= 水位线），每秒一批：f(时间戳, 条目)
      * @param out 输出流
-     * @return 按时间戳排序的数据向量
+     * @return 取出的条目数
      */
-    vector<T> getProcessableData(ostream &out)
+    template <class F>
+    size_t getProcessableData(ostream &out, F &&f)
     {
-        vector<T> result;
-
-        // 从缓冲区中取出所有时间戳 <= watermark 的数据
-        while (!orderedBuffer.empty() && 
-               orderedBuffer.top().timeStamp <= watermark)
+        size_t count = 0;
+        for (size_t i = 0; i < readyCount; i++)
         {
-            result.push_back(orderedBuffer.top());
-            orderedBuffer.pop();
-            totalProcessed++;
-            totalBuffered--;
+            f(ready[i].timeStamp, ready[i].items);
+            count += ready[i].items.size();
         }
+        readyCount = 0;
+        totalProcessed += (long long)count;
 
-        if (!result.empty())
+        if (count > 0)
         {
-            out << "[处理] 从缓冲区取出 " << result.size() 
+            out << "[处理] 从缓冲区取出 " << count
                 << " 条数据进行处理" << endl;
         }
 
-        return result;
+        return count;
     }
 
     /**
-     * 强制清空缓冲区（用于缓冲区满或程序结束时）
+     * 强制清空缓冲区（用于程序结束时）：推进水位线到最大观察时间戳，按时间顺序交出所有数据
      * @param out 输出流
-     * @return 返回缓冲区中的所有数据
+     * @return 取出的条目数
      */
-    vector<T> forceFlush(ostream &out)
+    template <class F>
+    size_t forceFlush(ostream &out, F &&f)
     {
-        out << "[强制清空] 清空缓冲区，共 " << orderedBuffer.size() << " 条数据" << endl;
-        
+        out << "[强制清空] 清空缓冲区，共 " << totalBuffered << " 条数据" << endl;
+
         // 推进水位线到最大观察时间戳
-        watermark = maxObservedTimestamp;
-        
+        advance(maxObservedTimestamp);
+
         // 取出所有数据
-        vector<T> all;
-        while (!orderedBuffer.empty())
+        size_t count = 0;
+        for (size_t i = 0; i < readyCount; i++)
         {
-            all.push_back(orderedBuffer.top());
-            orderedBuffer.pop();
-            totalProcessed++;
+            f(ready[i].timeStamp, ready[i].items);
+            count += ready[i].items.size();
         }
-        
-        totalBuffered = 0;
-        return all;
+        readyCount = 0;
+        totalProcessed += (long long)count;
+        return count;
     }
 
     /**
@@ -203,7 +302,7 @@ public:
      */
     size_t getBufferSize() const
     {
-        return orderedBuffer.size();
+        return (size_t)totalBuffered;
     }
 
     /**
@@ -230,6 +329,101 @@ public:
             double dropRate = (double)totalDropped / (totalProcessed + totalDropped) * 100;
             out << "丢弃率: " << dropRate << "%" << endl;
         }
+        if (delays.size() > 0)
+        {
+            out << "句子延迟分位数: p50 " << delays.quantile(0.5) << " 秒, p99 " << delays.quantile(0.99)
+                << " 秒, p99.9 " << delays.quantile(0.999) << " 秒（近期 " << delays.size() << " 个句子）" << endl;
+        }
+        if (adaptive)
+        {
+            out << "自适应允许延迟: 当前 " << lateness << " 秒（目标 " << quantile * 100 << "% 分位数，上限 "
+                << allowedLateness << " 秒），调整 " << adjustments << " 次，取值范围 ["
+                << lowestLateness << ", " << highestLateness << "] 秒" << endl;
+        }
+    }
+
+    // 对缓冲区和待处理列表中的每一项调用 f，用于编号回收
+    template <class F>
+    void forEachItem(F &&f) const
+    {
+        for (const batch &slot : ring)
+        {
+            for (const T &item : slot.items)    f(item);
+        }
+        for (size_t i = 0; i < readyCount; i++)
+        {
+            for (const T &item : ready[i].items)    f(item);
+        }
+    }
+
+    /**
+     * 保存到检查点：水位线、统计量和缓冲区中的每一批（T 必须可按字节复制）
+     */
+    template <class Writer>
+    void save(Writer &writer) const
+    {
+        writer.put(watermark);
+        writer.put(maxObservedTimestamp);
+        writer.put(totalProcessed);
+        writer.put(totalDropped);
+        writer.put(lateness);
+        writer.put(adjustments);
+        writer.put(lowestLateness);
+        writer.put(highestLateness);
+        writer.put(sinceTune);
+        delays.save(writer);
+        // 先是待处理列表，再按时间顺序是各槽位
+        vector<const batch *> batches;
+        for (size_t i = 0; i < readyCount; i++)    batches.push_back(&ready[i]);
+        for (long long s = watermark + 1; s <= watermark + (long long)ring.size(); s++)
+        {
+            const batch &slot = ring[(size_t)s & mask];
+            if (!slot.items.empty())    batches.push_back(&slot);
+        }
+        writer.put((uint64_t)batches.size());
+        for (const batch *b : batches)
+        {
+            writer.put(b->timeStamp);
+            writer.putVector(b->items);
+        }
+    }
+
+    /**
+     * 从检查点恢复（允许延迟可以与保存时不同，超出当前槽位范围的批次直接进入待处理列表；
+     * 固定延迟时实际延迟取当前的 allowedLateness，自适应时沿用保存的值但不超过 allowedLateness）
+     * @return false 如果数据不完整
+     */
+    template <class Reader>
+    bool load(Reader &reader)
+    {
+        uint64_t count;
+        if (!reader.get(watermark) || !reader.get(maxObservedTimestamp) || !reader.get(totalProcessed)
+            || !reader.get(totalDropped) || !reader.get(lateness) || !reader.get(adjustments)
+            || !reader.get(lowestLateness) || !reader.get(highestLateness) || !reader.get(sinceTune)
+            || !delays.load(reader) || !reader.get(count))
+        {
+            return false;
+        }
+        if (!adaptive || lateness > allowedLateness)    lateness = allowedLateness;
+        for (batch &slot : ring)    slot.items.clear();
+        readyCount = 0;
+        totalBuffered = 0;
+        batch entry;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            if (!reader.get(entry.timeStamp) || !reader.getVector(entry.items))    return false;
+            if (entry.timeStamp <= watermark || entry.timeStamp > watermark + (long long)ring.size())
+            {
+                vector<T> &target = readyBatch(entry.timeStamp);
+                target.insert(target.end(), entry.items.begin(), entry.items.end());
+                continue;
+            }
+            batch &slot = ring[(size_t)entry.timeStamp & mask];
+            slot.timeStamp = entry.timeStamp;
+            slot.items.insert(slot.items.end(), entry.items.begin(), entry.items.end());
+            totalBuffered += (long long)entry.items.size();
+        }
+        return true;
     }
 
     /**
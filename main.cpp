@@ -6,8 +6,12 @@
 #include <vector>
 #include <cstdlib>
 #include <map>
+#include <algorithm>
+#include <chrono>
 
 #include "hotWord.cpp"
+#include "inputReader.cpp"
+#include "segmentPipeline.cpp"
 
 
 using namespace std;
@@ -35,30 +39,191 @@ bool ReadConfig(const string &configFile, map<string, string> &config)
     return true;
 }
 
-// 从文件中读取 UTF-8 编码的每一行，并存储到 vector 中。
-bool ReadUtf8Lines(const string &filename, vector<string> &lines)
+// 在 ACTION 行中查找独立的参数 key（如 "W="），要求前面是行首、空格或 ']'，返回值的起始位置
+size_t FindParam(const string &line, const string &key)
 {
-    ifstream ifs(filename, ios::binary);
-    if (!ifs.is_open())
+    for (size_t pos = line.find(key); pos != string::npos; pos = line.find(key, pos + 1))
     {
-        return false; // 文件无法打开
+        if (pos == 0 || line[pos - 1] == ' ' || line[pos - 1] == ']')    return pos + key.size();
     }
-    string line;
-    while (getline(ifs, line))
+    return string::npos;
+}
+
+// ACTION 行中 pos 处开始的参数值：跳过前导空格，到下一个空格为止
+string ParamToken(const string &line, size_t pos)
+{
+    size_t begin = line.find_first_not_of(' ', pos);
+    if (begin == string::npos)    return "";
+    size_t end = line.find(' ', begin);
+    return line.substr(begin, end == string::npos ? string::npos : end - begin);
+}
+
+// 检查点：记录已处理的输入行数及其指纹，定时或收到 ACTION CHECKPOINT 时把完整状态写入 path
+struct CheckpointControl
+{
+    string path;               // 空表示不写检查点
+    long long seconds = 0;     // 定时写入的间隔（秒，按墙钟时间），0 表示只在 ACTION CHECKPOINT 时写入
+    string input;              // 输入路径，写入检查点用于恢复时核对
+    long long linesApplied = 0;
+    uint64_t hash = INPUT_HASH_SEED; // 已处理各行的指纹
+    chrono::steady_clock::time_point last = chrono::steady_clock::now();
+
+    void save(hotWord &hw, ofstream &ofs, const string &currTime)
     {
-        // 去掉 Windows 换行符中的 \r
-        if (!line.empty() && line.back() == '\r')
-        {
-            line.pop_back();
-        }
-        if (!line.empty())
+        checkpointInput saved;
+        saved.path = input;
+        StatInputFile(input, saved.device, saved.inode, saved.size);
+        saved.lines = linesApplied;
+        saved.hash = hash;
+        hw.saveCheckpoint(path, saved, currTime, ofs);
+        last = chrono::steady_clock::now();
+    }
+
+    // 开始处理一行时调用（按处理顺序）：计入已处理的行数和指纹
+    void lineConsumed(const char *data, size_t len)
+    {
+        linesApplied++;
+        hash = InputLineHash(hash, data, len);
+    }
+
+    // 每处理完一行调用：到了定时间隔就写检查点（每 1024 行才读一次时钟）
+    void lineApplied(hotWord &hw, ofstream &ofs, const string &currTime)
+    {
+        if (path.empty() || seconds <= 0 || (linesApplied & 1023) != 0)    return;
+        if (chrono::steady_clock::now() - last >= chrono::seconds(seconds))    save(hw, ofs, currTime);
+    }
+};
+
+// 执行一条 ACTION 命令（Top-K 查询、历史时段查询、调整窗口、趋势查询）
+void HandleAction(const string &line, hotWord &hw, ofstream &ofs, const string &currTime)
+{
+    // WINDOW=<秒> 在线调整窗口长度，可用 W=<秒> 指定要调整的窗口，缺省为 windowSize
+    size_t windowPos = FindParam(line, "WINDOW=");
+    if (windowPos != string::npos)
+    {
+        long long newSize = stoll(line.substr(windowPos));
+        size_t Wpos = FindParam(line, "W=");
+        long long target = Wpos != string::npos ? stoll(line.substr(Wpos)) : 0;
+        size_t w = target > 0 ? hw.findWindow(target) : 0;
+        ofs << currTime << "，请求把窗口调整为 " << newSize << " 秒：" << endl;
+        if (w == hw.windowCount())    ofs << "没有长度为 " << target << " 秒的窗口" << endl;
+        else    hw.setWindowSize(newSize, ofs, w);
+        return;
+    }
+    // TREND K=<数字> 获取上升 / 下降最快的词
+    if (FindParam(line, "TREND") != string::npos)
+    {
+        size_t Kpos = FindParam(line, "K=");
+        int k = Kpos != string::npos ? stoi(line.substr(Kpos)) : 10;
+        ofs << currTime << "，请求获取变化最快的 " << k << " 个词：" << endl;
+        hw.getTrend(k, ofs);
+        return;
+    }
+    // QUERY TOPK K=<数字> FROM <时间> TO <时间>：从分钟 / 小时 / 天汇总中查询历史时间段 [FROM, TO) 的热词
+    size_t fromPos = FindParam(line, "FROM ");
+    if (fromPos != string::npos)
+    {
+        size_t toPos = FindParam(line, "TO ");
+        size_t Kpos = FindParam(line, "K=");
+        int k = Kpos != string::npos ? stoi(line.substr(Kpos)) : 10;
+        string fromText = ParamToken(line, fromPos);
+        string toText = toPos != string::npos ? ParamToken(line, toPos) : "";
+        long long from = ParseQueryTime(fromText.data(), fromText.size());
+        long long to = ParseQueryTime(toText.data(), toText.size());
+        ofs << currTime << "，请求获取 " << fromText << " 至 " << toText << " 的前 " << k << " 个热词：" << endl;
+        if (from == -1 || to == -1 || from >= to)    ofs << "时间范围格式错误" << endl;
+        else    hw.getTopKInRange(k, from, to, ofs);
+        return;
+    }
+    size_t Kpos = line.find("K=");
+    if (Kpos != string::npos)
+    {
+        int k = stoi(line.substr(Kpos + 2));
+        // W=<秒> 指定查询的窗口长度（见 windowSizes），缺省为 windowSize
+        size_t Wpos = FindParam(line, "W=");
+        long long w = Wpos != string::npos ? stoll(line.substr(Wpos)) : 0;
+        if (w > 0)    ofs << currTime << "，请求获取前 " << k << " 个热词（窗口 " << w << " 秒）：" << endl;
+        else    ofs << currTime << "，请求获取前 " << k << " 个热词：" << endl;
+        // 获取并显示 top k 热词
+        hw.getTopK(k, ofs, w);
+    }
+}
+
+// 处理一行输入：ACTION 行执行命令，其余行交给 hotWord 处理
+void HandleLine(const string &line, hotWord &hw, ofstream &ofs, string &currTime, CheckpointControl &checkpoint)
+{
+    checkpoint.lineConsumed(line.data(), line.size());
+    if (line.find("ACTION") != string::npos)
+    {
+        // CHECKPOINT 立即写入检查点（这一行本身计入已处理的行数）
+        if (FindParam(line, "CHECKPOINT") != string::npos)
         {
-            lines.push_back(line); // 将非空行存储到 vector 中
+            ofs << currTime << "，请求写入检查点：" << endl;
+            if (checkpoint.path.empty())    ofs << "未配置 checkpointFile" << endl;
+            else    checkpoint.save(hw, ofs, currTime);
+            return;
         }
+        HandleAction(line, hw, ofs, currTime);
     }
-    return true;
+    else
+    {
+        currTime = hw.processSentence(line, ofs);
+    }
+    checkpoint.lineApplied(hw, ofs, currTime);
 }
 
+// 处理一行输入（切片版本）：普通句子直接以切片交给 hotWord，不拷贝整行
+void HandleLine(const char *data, size_t len, hotWord &hw, ofstream &ofs, string &currTime, CheckpointControl &checkpoint)
+{
+    static const char action[] = "ACTION";
+    if (search(data, data + len, action, action + sizeof(action) - 1) != data + len)
+    {
+        HandleLine(string(data, len), hw, ofs, currTime, checkpoint); // ACTION 行很少，直接复用字符串版本
+    }
+    else
+    {
+        checkpoint.lineConsumed(data, len);
+        currTime = hw.processSentence(data, len, ofs);
+        checkpoint.lineApplied(hw, ofs, currTime);
+    }
+}
+
+// 离线查询快照日志：统计 [from, to] 内出现次数最多的 k 个词，不需要加载词典或重新分词
+int QuerySnapshotLog(const string &prefix, const string &fromText, const string &toText, int k)
+{
+    long long from = ParseQueryTime(fromText.data(), fromText.size());
+    long long to = ParseQueryTime(toText.data(), toText.size());
+    if (from == -1 || to == -1 || from > to)
+    {
+        cerr << "[ERROR] 时间范围格式错误: " << fromText << " " << toText << endl;
+        return EXIT_FAILURE;
+    }
+    snapshotLogReader reader;
+    if (!reader.open(prefix))
+    {
+        cerr << "[ERROR] 无法读取快照日志: " << prefix << endl;
+        return EXIT_FAILURE;
+    }
+    vector<long long> counts(reader.wordCount(), 0);
+    reader.scan(from, to, [&](uint32_t id, long long count)
+    {
+        if (id < counts.size())    counts[id] += count;
+    });
+    vector<pair<long long, uint32_t>> ranked;
+    for (uint32_t id = 0; id < counts.size(); id++)
+    {
+        if (counts[id] > 0)    ranked.push_back(make_pair(counts[id], id));
+    }
+    size_t n = min(ranked.size(), (size_t)max(k, 0));
+    partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(),
+        [](const pair<long long, uint32_t> &a, const pair<long long, uint32_t> &b) { return a.first > b.first; });
+    cout << fromText << " 至 " << toText << " 的前 " << k << " 个热词（每 " << reader.bucketLength() << " 秒一条记录）：" << endl;
+    for (size_t i = 0; i < n; i++)
+    {
+        cout << i + 1 << ". " << reader.word(ranked[i].second) << " (出现次数: " << ranked[i].first << ")" << endl;
+    }
+    return EXIT_SUCCESS;
+}
 
 int main(int argc, char *argv[])
 {
@@ -71,18 +236,82 @@ int main(int argc, char *argv[])
     // 输入输出文件路径
     string inputFile = config.count("inputFile") ? config["inputFile"] : "input1.txt";
     string outputFile = config.count("outputFile") ? config["outputFile"] : "output.txt";
+    // 输入方式：stream（逐行流式读取）或 mmap（内存映射，零拷贝）
+    string inputMode = config.count("inputMode") ? config["inputMode"] : "stream";
+    // 实时模式：持续读取标准输入、命名管道或不断增长的文件（tail -f），直到收到 SIGINT/SIGTERM
+    bool followMode = config.count("followMode") ? (config["followMode"] == "true") : false;
     // 如果有命令行参数，则覆盖配置文件中的设置
-    if (argc >= 2)    inputFile = argv[1];
-    if (argc >= 3)    outputFile = argv[2];
+    vector<string> positional;
+    // --compile-dict <out>：把词典、用户词典和 HMM 模型编译成一个可 mmap 加载的镜像后退出
+    string compileDictOut;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--follow" || arg == "-f")    followMode = true;
+        else if (arg == "--compile-dict" && i + 1 < argc)    compileDictOut = argv[++i];
+        else if (arg == "--query-log" && i + 3 < argc)
+        {
+            // --query-log <prefix> <from> <to> [K]：离线查询快照日志后退出
+            int k = i + 4 < argc ? atoi(argv[i + 4]) : 10;
+            return QuerySnapshotLog(argv[i + 1], argv[i + 2], argv[i + 3], k);
+        }
+        else    positional.push_back(arg);
+    }
+    if (positional.size() >= 1)    inputFile = positional[0];
+    if (positional.size() >= 2)    outputFile = positional[1];
+    // 输入为 "-" 时读取标准输入
+    bool liveInput = followMode || inputFile == "-";
         
     // 是否启用迟到数据处理
     bool    enableLateDataHandling = config.count("enableLateDataHandling") ? (config["enableLateDataHandling"] == "true") : true;
     
+    // 迟到数据的处理方式：buffer（按 allowedLateness 缓冲重排，结果落后 allowedLateness 秒）
+    // 或 retroactive（不缓冲，迟到的出现直接修正到窗口中所在的桶，只丢弃早于所有窗口的出现）
+    string lateDataMode = config.count("lateDataMode") ? config["lateDataMode"] : "buffer";
+
     // 允许的最大延迟时间（秒）
     long long allowedLateness = config.count("allowedLateness") ? std::stoll(config["allowedLateness"]) : 30;
     
+    // 分词线程数：大于 1 时启用并行分词流水线（输出与单线程逐字节一致）
+    int segmentThreads = config.count("segmentThreads") ? std::stoi(config["segmentThreads"]) : 1;
+
+    // 计数分片数：大于 1 时按词划分到多个计数线程，各自维护计数器和窗口，Top-K 查询时合并
+    int countingShards = config.count("countingShards") ? std::stoi(config["countingShards"]) : 1;
+
     // 时间窗口大小（秒）
     long long windowSize = config.count("windowSize") ? std::stoll(config["windowSize"]) : 600;
+    // 计数引擎：exact（精确）、spacesaving、countmin 或 panesketch（固定内存的近似计数，Top-K 附带误差上界）
+    countingOptions counting;
+    if (config.count("countingEngine"))    counting.engine = config["countingEngine"];
+    if (config.count("engineCapacity"))    counting.capacity = std::stoul(config["engineCapacity"]);
+    if (config.count("sketchWidth"))    counting.sketchWidth = std::stoul(config["sketchWidth"]);
+    if (config.count("sketchDepth"))    counting.sketchDepth = std::stoul(config["sketchDepth"]);
+    if (config.count("paneSeconds"))    counting.paneSeconds = std::stoll(config["paneSeconds"]);
+
+    // 额外的窗口长度（秒，逗号分隔）：与 windowSize 共用一次分词和同一组桶，查询时用 ACTION K=10 W=3600 指定
+    vector<long long> windowSizes;
+    if (config.count("windowSizes"))
+    {
+        stringstream ss(config["windowSizes"]);
+        string item;
+        while (getline(ss, item, ','))
+        {
+            if (!item.empty())    windowSizes.push_back(std::stoll(item));
+        }
+    }
+
+    // 窗口策略：time（按事件时间，windowSize 秒）或 count（最近 windowMessages 条消息，适合低流量频道）
+    string windowPolicy = config.count("windowPolicy") ? config["windowPolicy"] : "time";
+    size_t windowMessages = config.count("windowMessages") ? std::stoul(config["windowMessages"]) : 1000;
+    if (windowPolicy != "count")    windowMessages = 0;
+
+    // 保留期（秒）：桶至少保留这么久，ACTION WINDOW= 放大窗口时最多能从历史中恢复到这个长度
+    long long retentionSeconds = config.count("retentionSeconds") ? std::stoll(config["retentionSeconds"]) : 0;
+    // 放大窗口时每次调用最多重新计入的 (词, 次数) 对数，剩余部分在之后的句子中继续
+    size_t restoreBudget = config.count("windowRestoreBudget") ? std::stoul(config["windowRestoreBudget"]) : 100000;
+
+    // 窗口分桶粒度（秒）：同一桶内的词按 (词, 次数) 聚合，过期时整桶丢弃
+    long long bucketSeconds = config.count("bucketSeconds") ? std::stoll(config["bucketSeconds"]) : 1;
     
     // 词典文件路径
     std::string dictPath = config.count("dictPath") ? config["dictPath"] : "dict/jieba.dict.utf8";
@@ -90,6 +319,24 @@ int main(int argc, char *argv[])
     std::string userDictPath = config.count("userDictPath") ? config["userDictPath"] : "dict/user.dict.utf8";
     std::string idfPath = config.count("idfPath") ? config["idfPath"] : "dict/idf.utf8";
     std::string stopWordPath = config.count("stopWordPath") ? config["stopWordPath"] : "dict/stop_words.utf8";
+    // 词典 Trie 的实现：hash（每个节点一个哈希表）或 double_array（双数组 Trie，缓存友好）
+    DictTrie::TrieBackend trieBackend = (config.count("trieBackend") && config["trieBackend"] == "double_array")
+        ? DictTrie::DoubleArrayTrieBackend : DictTrie::HashTrieBackend;
+    if (compileDictOut.empty() && trieBackend != DictTrie::DoubleArrayTrieBackend && IsDictImage(dictPath))
+    {
+        cout << "[INFO ] dictPath 是词典镜像，使用镜像中的 double_array Trie，trieBackend 不生效" << endl;
+    }
+
+    if (!compileDictOut.empty())
+    {
+        if (!Jieba::CompileDictImage(dictPath, modelPath, userDictPath, compileDictOut))
+        {
+            cerr << "[ERROR] 无法写入词典镜像: " << compileDictOut << endl;
+            return EXIT_FAILURE;
+        }
+        cout << "[INFO ] 词典镜像已写入 '" << compileDictOut << "'，将 dictPath 和 modelPath 指向它即可加载。" << endl;
+        return EXIT_SUCCESS;
+    }
     
     // 打开输出文件
     ofstream ofs(outputFile, ios::binary);
@@ -99,16 +346,17 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
     
-    // 从输入文件中读取句子
-    vector<string> lines;
-    if (!ReadUtf8Lines(inputFile, lines))
+    // 打开输入文件（逐行流式读取，不再一次性载入整个文件）
+    // 实时模式下由 FollowUtf8Lines 自行打开，避免在命名管道上提前阻塞
+    ifstream ifs;
+    if (!liveInput)    ifs.open(inputFile, ios::binary);
+    if (!liveInput && !ifs.is_open())
     {
         cerr << "[ERROR] 无法打开输入文件: " << inputFile << endl;
         cerr << "[HINT ] 请创建一个 UTF-8 编码的文件，命名为 '" << inputFile << "'，并写入中文句子。" << endl;
         ofs.close();
         return EXIT_FAILURE;
     }
-    if (lines.empty())    cerr << "[WARN ] 输入文件为空。" << endl;
 
     // 初始化hotWord类
     hotWord hw(
@@ -120,33 +368,201 @@ int main(int argc, char *argv[])
         windowSize,
         ofs,
         enableLateDataHandling,
-        allowedLateness
+        allowedLateness,
+        trieBackend,
+        bucketSeconds,
+        counting,
+        windowSizes,
+        retentionSeconds,
+        restoreBudget,
+        windowMessages,
+        countingShards
     );
 
-    // 处理每个句子
+    bool lateBuffered = enableLateDataHandling;
+    if (enableLateDataHandling && lateDataMode == "retroactive" && hw.enableRetroactiveLateData(ofs))    lateBuffered = false;
+
+    // 自适应允许延迟：按观察到的延迟分布把缓冲区的延迟调整为 latenessPercentile 分位数，allowedLateness 为上限
+    if (lateBuffered && config.count("adaptiveLateness") && config["adaptiveLateness"] == "true")
+    {
+        double latenessPercentile = config.count("latenessPercentile") ? std::stod(config["latenessPercentile"]) : 99.9;
+        hw.enableAdaptiveLateness(latenessPercentile / 100, ofs);
+    }
+
+    // Top-K 快照：每 snapshotInterval 个句子发布一次前 snapshotK 名，供 hotWord::readTopK 读取（ACTION 查询不受影响）
+    if (config.count("topKSnapshots") && config["topKSnapshots"] == "true")
+    {
+        size_t snapshotK = config.count("snapshotK") ? std::stoul(config["snapshotK"]) : 100;
+        long long snapshotInterval = config.count("snapshotInterval") ? std::stoll(config["snapshotInterval"]) : 1000;
+        hw.enableSnapshots(snapshotK, snapshotInterval);
+    }
+
+    // 趋势统计：按 trendBucketSeconds 分桶，0（默认）表示不统计
+    long long trendBucketSeconds = config.count("trendBucketSeconds") ? std::stoll(config["trendBucketSeconds"]) : 0;
+    int trendSpan = config.count("trendSpan") ? std::stoi(config["trendSpan"]) : 5;
+    if (trendBucketSeconds > 0)    hw.enableTrend(trendBucketSeconds, trendSpan);
+
+    // 突发检测：当前桶的次数相对 EWMA 基线的 z-score 越过 burstThreshold 时输出报警
+    if (config.count("burstDetection") && config["burstDetection"] == "true")
+    {
+        long long burstBucketSeconds = config.count("burstBucketSeconds") ? std::stoll(config["burstBucketSeconds"]) : 60;
+        int burstSpan = config.count("burstSpan") ? std::stoi(config["burstSpan"]) : 10;
+        double burstThreshold = config.count("burstThreshold") ? std::stod(config["burstThreshold"]) : 3.0;
+        int burstMinCount = config.count("burstMinCount") ? std::stoi(config["burstMinCount"]) : 5;
+        int burstWarmup = config.count("burstWarmupBuckets") ? std::stoi(config["burstWarmupBuckets"]) : 3;
+        hw.enableBurstDetection(burstBucketSeconds, burstSpan, burstThreshold, burstMinCount, burstWarmup);
+    }
+
+    // 时间汇总：保存每分钟、每小时、每天的 (词, 次数)，支持 ACTION QUERY TOPK K=<n> FROM <时间> TO <时间>
+    // 分钟 / 小时汇总并入更粗一级后只保留 rollupMinuteRetention 分钟 / rollupHourRetention 小时（0 表示一直保留）
+    if (config.count("timeRollups") && config["timeRollups"] == "true")
+    {
+        long long minuteRetention = config.count("rollupMinuteRetention") ? std::stoll(config["rollupMinuteRetention"]) : 1440;
+        long long hourRetention = config.count("rollupHourRetention") ? std::stoll(config["rollupHourRetention"]) : 720;
+        hw.enableRollups(minuteRetention, hourRetention);
+    }
+
+    // 词编号回收：新分配 max(wordIdRecycleMin, 在用词数) 个编号后释放不再被引用的词（0 表示不回收）
+    size_t recycleMin = config.count("wordIdRecycleMin") ? std::stoul(config["wordIdRecycleMin"]) : 0;
+    if (recycleMin > 0)    hw.enableSymbolRecycling(recycleMin);
+
+    // 窗口快照日志：每 snapshotLogBucketSeconds 秒一条 (词编号, 次数) 记录，供 --query-log 离线查询
+    if (config.count("snapshotLog") && !config["snapshotLog"].empty())
+    {
+        long long logBucketSeconds = config.count("snapshotLogBucketSeconds") ? std::stoll(config["snapshotLogBucketSeconds"]) : 60;
+        size_t logIndexEvery = config.count("snapshotLogIndexEvery") ? std::stoul(config["snapshotLogIndexEvery"]) : 16;
+        if (hw.enableSnapshotLog(config["snapshotLog"], logBucketSeconds, logIndexEvery, ofs))
+        {
+            cout << "[INFO ] 窗口快照日志: " << config["snapshotLog"] << ".log" << endl;
+        }
+    }
+
+    // 检查点：定时（checkpointSeconds）或收到 ACTION CHECKPOINT 时写入 checkpointFile；
+    // restoreCheckpoint=true 时启动时从中恢复，并跳过输入开头已经处理过的行。
+    // 检查点记录了输入路径、文件标识和已处理各行的指纹，与当前输入不符时忽略检查点、从头处理
+    CheckpointControl checkpoint;
+    checkpoint.path = config.count("checkpointFile") ? config["checkpointFile"] : "";
+    checkpoint.seconds = config.count("checkpointSeconds") ? std::stoll(config["checkpointSeconds"]) : 0;
+    checkpoint.input = inputFile;
+    bool restoreCheckpoint = config.count("restoreCheckpoint") ? (config["restoreCheckpoint"] == "true") : false;
     string currTime;
-    for (auto &line : lines)
+    long long skipLines = 0;
+    if (!checkpoint.path.empty() && restoreCheckpoint)
     {
-        if (line.find("ACTION") != string::npos)
+        checkpointInput saved;
+        auto sameInput = [&](const checkpointInput &input)
         {
-            int Kpos = line.find("K=");
-            if (Kpos != string::npos)
+            if (input.path != inputFile)
+            {
+                ofs << "检查点对应的输入是 " << input.path << "，与当前输入不符，忽略检查点: " << checkpoint.path << endl;
+                return false;
+            }
+            // 实时输入无法重放，只核对路径
+            if (liveInput)    return true;
+            uint64_t device, inode, size, hash;
+            StatInputFile(inputFile, device, inode, size);
+            if (device != input.device || inode != input.inode || size < input.size)
+            {
+                ofs << "输入文件 " << inputFile << " 已被替换或截断，忽略检查点: " << checkpoint.path << endl;
+                return false;
+            }
+            if (!HashInputPrefix(inputFile, input.lines, hash) || hash != input.hash)
             {
-                int k = stoi(line.substr(Kpos + 2));
-                ofs << currTime << "，请求获取前 " << k << " 个热词：" << endl;
-                // 获取并显示 top k 热词
-                hw.getTopK(k, ofs);
+                ofs << "输入文件 " << inputFile << " 开头已处理的 " << input.lines << " 行与检查点不符，忽略检查点: "
+                    << checkpoint.path << endl;
+                return false;
             }
+            return true;
+        };
+        checkpointStatus status = hw.loadCheckpoint(checkpoint.path, saved, currTime, ofs, sameInput);
+        if (status == CheckpointCorrupt)
+        {
+            cerr << "[ERROR] 检查点损坏: " << checkpoint.path << "，请删除后重新运行。" << endl;
+            return EXIT_FAILURE;
         }
-        else
+        if (status == CheckpointRestored)
         {
-            currTime = hw.processSentence(line, ofs);
+            checkpoint.linesApplied = saved.lines;
+            checkpoint.hash = saved.hash;
+            cout << "[INFO ] 已从检查点 '" << checkpoint.path << "' 恢复，已处理 " << checkpoint.linesApplied << " 行。" << endl;
+            // 实时输入无法重放，从当前位置继续
+            if (!liveInput)    skipLines = checkpoint.linesApplied;
         }
     }
 
+    // 边读边处理每个句子
+    SegmentPipeline *pipeline = nullptr;
+    if (segmentThreads > 1)
+    {
+        pipeline = new SegmentPipeline(hw, segmentThreads, [&](pipelineLine &item)
+        {
+            // 排序阶段：按输入顺序更新计数器与窗口、回答查询
+            if (item.isAction)    HandleLine(item.line, hw, ofs, currTime, checkpoint);
+            else
+            {
+                checkpoint.lineConsumed(item.line.data(), item.line.size());
+                currTime = hw.applySegmented(item.seg, ofs);
+                checkpoint.lineApplied(hw, ofs, currTime);
+            }
+        });
+        cout << "[INFO ] 并行分词已启用，分词线程数: " << segmentThreads << endl;
+    }
+    auto onLine = [&](const char *data, size_t len)
+    {
+        if (skipLines > 0)
+        {
+            skipLines--;
+            return;
+        }
+        if (pipeline != nullptr)    pipeline->push(data, len);
+        else    HandleLine(data, len, hw, ofs, currTime, checkpoint);
+    };
+
+    long long lineCount = 0;
+    bool mapped = false;
+    if (liveInput)
+    {
+#ifndef _WIN32
+        InstallStopHandler();
+#endif
+        cout << "[INFO ] 实时模式：持续读取 '" << inputFile << "'，按 Ctrl+C 结束。" << endl;
+        bool opened = FollowUtf8Lines(inputFile, onLine, [&]()
+        {
+            // 等待新数据前把已读入的行处理完，并把查询结果写出
+            if (pipeline != nullptr)    pipeline->drain();
+            ofs.flush();
+        }, lineCount);
+        if (!opened)
+        {
+            cerr << "[ERROR] 无法打开输入: " << inputFile << endl;
+            delete pipeline;
+            ofs.close();
+            return EXIT_FAILURE;
+        }
+    }
+    else if (inputMode == "mmap")
+    {
+        mapped = MapUtf8Lines(inputFile, onLine, lineCount);
+        if (!mapped)    cerr << "[WARN ] 无法内存映射输入文件，改用流式读取。" << endl;
+    }
+    if (!liveInput && !mapped)
+    {
+        lineCount = StreamUtf8Lines(ifs, [&](const string &line)
+        {
+            onLine(line.data(), line.size());
+        });
+    }
+    ifs.close();
+    if (pipeline != nullptr)
+    {
+        pipeline->finish();
+        delete pipeline;
+    }
+    if (lineCount == 0)    cerr << "[WARN ] 输入文件为空。" << endl;
+
 
-    // 如果启用了迟到数据处理，在程序结束前强制清空缓冲区
-    if (enableLateDataHandling)
+    // 如果启用了迟到数据缓冲，在程序结束前强制清空缓冲区
+    if (lateBuffered)
     {
         ofs << endl << "================ 程序结束，强制处理缓冲区数据 ================" << endl;
         hw.forceFlushBuffer(ofs);
@@ -0,0 +1,168 @@
+#ifndef MESSAGE_WINDOW_CPP
+#define MESSAGE_WINDOW_CPP
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/**
+ * 按消息条数计的滑动窗口：保留最近 capacity 条消息的词
+ * 所有词编号依次存放在一个环形数组中，另一个环形数组保存每条消息的词数（消息在词环中的区间首尾相接，
+ * 起点可由前一条推出），内存与窗口内的消息条数和词数成正比，不为每个词单独保存时间戳
+ * 新消息进入后，超出 capacity 的最早消息整条移出，代价 O(该消息的词数)
+ * 消息按进入顺序编号，移出时把消息的序号作为批次交给计数器（见 countingEngine）
+ */
+class messageWindow
+{
+private:
+    size_t capacity;
+
+    vector<uint32_t> tokens;  // 词编号环
+    size_t tokenHead = 0;     // 最早的词的位置
+    size_t tokenCount = 0;
+
+    vector<uint32_t> lengths; // 每条消息的词数环
+    size_t messageHead = 0;
+    size_t messageCount = 0;
+    unsigned long long oldest = 0; // 最早的消息的序号
+
+    void pushToken(uint32_t id)
+    {
+        if (tokenCount == tokens.size())
+        {
+            // 环满时按两倍扩容，并把内容展开到从 0 开始
+            vector<uint32_t> grown(tokens.empty() ? 64 : tokens.size() * 2);
+            for (size_t i = 0; i < tokenCount; i++)    grown[i] = tokens[(tokenHead + i) % tokens.size()];
+            tokens.swap(grown);
+            tokenHead = 0;
+        }
+        tokens[(tokenHead + tokenCount++) % tokens.size()] = id;
+    }
+
+    void pushLength(uint32_t length)
+    {
+        if (messageCount == lengths.size())
+        {
+            vector<uint32_t> grown(lengths.empty() ? 64 : lengths.size() * 2);
+            for (size_t i = 0; i < messageCount; i++)    grown[i] = lengths[(messageHead + i) % lengths.size()];
+            lengths.swap(grown);
+            messageHead = 0;
+        }
+        lengths[(messageHead + messageCount++) % lengths.size()] = length;
+    }
+
+    // 移出最早的一条消息，对其中每个词调用 evict(词编号, 1, 消息序号)
+    template <class Evict>
+    void popMessage(Evict &&evict)
+    {
+        uint32_t length = lengths[messageHead];
+        messageHead = (messageHead + 1) % lengths.size();
+        messageCount--;
+        unsigned long long serial = oldest++;
+        for (uint32_t i = 0; i < length; i++)
+        {
+            evict(tokens[tokenHead], 1, serial);
+            tokenHead = (tokenHead + 1) % tokens.size();
+        }
+        tokenCount -= length;
+    }
+
+public:
+    explicit messageWindow(size_t capacity)
+        : capacity(capacity > 0 ? capacity : 1) {}
+
+    // 下一条加入的消息的序号
+    unsigned long long nextMessage() const
+    {
+        return oldest + messageCount;
+    }
+
+    /**
+     * 加入一条消息（ids 为其中的非停用词），然后移出超出窗口的最早消息
+     */
+    template <class Evict>
+    void addMessage(const vector<uint32_t> &ids, Evict &&evict)
+    {
+        for (uint32_t id : ids)    pushToken(id);
+        pushLength((uint32_t)ids.size());
+        while (messageCount > capacity)    popMessage(evict);
+    }
+
+    /**
+     * 调整窗口条数：缩小时立即移出多余的消息；放大只影响之后的消息，已移出的消息不会恢复
+     */
+    template <class Evict>
+    void resize(size_t newCapacity, Evict &&evict)
+    {
+        capacity = newCapacity > 0 ? newCapacity : 1;
+        while (messageCount > capacity)    popMessage(evict);
+    }
+
+    // 保存到检查点：窗口条数、每条消息的词数和所有词编号（从最早的开始）
+    template <class Writer>
+    void save(Writer &writer) const
+    {
+        writer.put((uint64_t)(capacity));
+        vector<uint32_t> orderedLengths(messageCount), orderedTokens(tokenCount);
+        for (size_t i = 0; i < messageCount; i++)    orderedLengths[i] = lengths[(messageHead + i) % lengths.size()];
+        for (size_t i = 0; i < tokenCount; i++)    orderedTokens[i] = tokens[(tokenHead + i) % tokens.size()];
+        writer.putVector(orderedLengths);
+        writer.putVector(orderedTokens);
+    }
+
+    /**
+     * 从检查点恢复，对窗口中的每个词调用 restore(词编号, 1, 消息序号) 以重建计数器（序号从 0 重新开始）
+     * @return false 如果数据不完整
+     */
+    template <class Reader, class Restore>
+    bool load(Reader &reader, Restore &&restore)
+    {
+        uint64_t savedCapacity;
+        vector<uint32_t> savedLengths, savedTokens;
+        if (!reader.get(savedCapacity) || !reader.getVector(savedLengths) || !reader.getVector(savedTokens))    return false;
+        capacity = savedCapacity > 0 ? (size_t)savedCapacity : 1;
+        tokens.clear();
+        lengths.clear();
+        tokenHead = tokenCount = messageHead = messageCount = 0;
+        oldest = 0;
+        uint64_t total = 0;
+        for (uint32_t length : savedLengths)    total += length;
+        if (total != savedTokens.size())    return false;
+        size_t next = 0;
+        for (size_t m = 0; m < savedLengths.size(); m++)
+        {
+            pushLength(savedLengths[m]);
+            for (uint32_t i = 0; i < savedLengths[m]; i++, next++)
+            {
+                pushToken(savedTokens[next]);
+                restore(savedTokens[next], 1, (unsigned long long)m);
+            }
+        }
+        return true;
+    }
+
+    // 对窗口中的每个词编号调用 f（同一个词可能多次），用于编号回收
+    template <class F>
+    void forEachId(F &&f) const
+    {
+        for (size_t i = 0; i < tokenCount; i++)    f(tokens[(tokenHead + i) % tokens.size()]);
+    }
+
+    size_t windowMessages() const
+    {
+        return capacity;
+    }
+
+    size_t messages() const
+    {
+        return messageCount;
+    }
+
+    size_t tokensInWindow() const
+    {
+        return tokenCount;
+    }
+};
+
+#endif
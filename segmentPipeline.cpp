@@ -0,0 +1,202 @@
+#ifndef SEGMENT_PIPELINE_CPP
+#define SEGMENT_PIPELINE_CPP
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// 流水线中的一行输入
+class pipelineLine
+{
+public:
+    string line;         // 原始行
+    bool isAction;       // ACTION 命令行不分词，原样交给排序阶段
+    segmentedLine seg;   // 分词结果
+};
+
+/**
+ * 并行分词流水线
+ *
+ * 三个阶段：
+ * 1. 读取阶段（调用 push 的线程）：把输入行按批打包，依次编号
+ * 2. 分词阶段（N 个工作线程）：共享同一个只读的 jieba，各自领取批次并分词
+ * 3. 排序阶段（1 个线程）：严格按编号顺序把分词结果交给 onOrdered，
+ *    由它更新 Counter / window 并回答 ACTION，因此输出与单线程运行逐字节一致
+ *
+ * 批次存放在大小固定的环形槽位中，读取阶段领先排序阶段最多 slotCount 个批次，
+ * 内存占用有上界；锁只在批次粒度上获取，工作线程分词时不持有锁。
+ */
+class SegmentPipeline
+{
+private:
+    enum SlotState { Free, Filled, Segmenting, Done };
+
+    class batchSlot
+    {
+    public:
+        vector<pipelineLine> lines;
+        size_t size = 0;   // 有效行数（lines 中的对象跨批次复用）
+        SlotState state = Free;
+    };
+
+    const hotWord &hw;
+    function<void(pipelineLine &)> onOrdered;
+    size_t batchSize;
+
+    vector<batchSlot> slots;
+    long long nextToFill = 0;     // 读取阶段正在填充的批次编号
+    long long nextToSegment = 0;  // 下一个待分词的批次编号
+    long long nextToApply = 0;    // 排序阶段下一个要应用的批次编号
+    size_t fillCount = 0;         // 正在填充的批次中已有的行数（只由读取阶段访问）
+    bool stopping = false;
+
+    mutex mtx;
+    condition_variable slotFreed;     // 排序阶段释放槽位 -> 读取阶段
+    condition_variable batchFilled;   // 读取阶段提交批次 -> 分词阶段
+    condition_variable batchDone;     // 分词完成 -> 排序阶段
+
+    vector<thread> workers;
+    thread sequencer;
+
+    batchSlot &slotOf(long long seq) { return slots[seq % slots.size()]; }
+
+    // 分词阶段：领取已提交的批次并分词
+    void workerLoop()
+    {
+        while (true)
+        {
+            long long seq;
+            {
+                unique_lock<mutex> lock(mtx);
+                batchFilled.wait(lock, [&]() { return stopping || nextToSegment < nextToFill; });
+                if (nextToSegment >= nextToFill)    return; // stopping 且没有剩余批次
+                seq = nextToSegment++;
+                slotOf(seq).state = Segmenting;
+            }
+            batchSlot &slot = slotOf(seq);
+            for (size_t i = 0; i < slot.size; i++)
+            {
+                pipelineLine &item = slot.lines[i];
+                if (!item.isAction)    hw.segment(item.line.data(), item.line.size(), item.seg);
+            }
+            {
+                lock_guard<mutex> lock(mtx);
+                slot.state = Done;
+            }
+            batchDone.notify_all();
+        }
+    }
+
+    // 排序阶段：按编号顺序应用分词结果
+    void sequencerLoop()
+    {
+        while (true)
+        {
+            long long seq;
+            {
+                unique_lock<mutex> lock(mtx);
+                batchDone.wait(lock, [&]()
+                {
+                    return (nextToApply < nextToFill && slotOf(nextToApply).state == Done)
+                        || (stopping && nextToApply >= nextToFill);
+                });
+                if (nextToApply >= nextToFill)    return;
+                seq = nextToApply;
+            }
+            batchSlot &slot = slotOf(seq);
+            for (size_t i = 0; i < slot.size; i++)    onOrdered(slot.lines[i]);
+            {
+                lock_guard<mutex> lock(mtx);
+                slot.state = Free;
+                slot.size = 0;
+                nextToApply++;
+            }
+            slotFreed.notify_all();
+        }
+    }
+
+    // 提交当前正在填充的批次（调用方需持有锁）
+    void submitLocked()
+    {
+        if (fillCount == 0)    return;
+        batchSlot &slot = slotOf(nextToFill);
+        slot.size = fillCount;
+        slot.state = Filled;
+        fillCount = 0;
+        nextToFill++;
+        batchFilled.notify_all();
+    }
+
+public:
+    /**
+     * @param hw 提供分词的 hotWord（分词阶段只调用其 const 成员）
+     * @param threadCount 分词线程数
+     * @param onOrdered 排序阶段回调，按输入顺序对每一行调用一次
+     * @param batchSize 每批行数
+     */
+    SegmentPipeline(const hotWord &hw, int threadCount, function<void(pipelineLine &)> onOrdered, size_t batchSize = 256)
+        : hw(hw), onOrdered(onOrdered), batchSize(batchSize)
+    {
+        if (threadCount < 1)    threadCount = 1;
+        slots.resize(threadCount * 4);
+        for (size_t i = 0; i < slots.size(); i++)    slots[i].lines.resize(batchSize);
+        for (int i = 0; i < threadCount; i++)    workers.push_back(thread(&SegmentPipeline::workerLoop, this));
+        sequencer = thread(&SegmentPipeline::sequencerLoop, this);
+    }
+
+    // 读取阶段：追加一行，批次满时提交
+    void push(const char *data, size_t len)
+    {
+        static const char action[] = "ACTION";
+        batchSlot &slot = slotOf(nextToFill);
+        if (fillCount == 0)
+        {
+            // 开始新批次：槽位可能仍被上一轮批次占用，等待排序阶段释放
+            unique_lock<mutex> lock(mtx);
+            slotFreed.wait(lock, [&]() { return slot.state == Free; });
+        }
+        pipelineLine &item = slot.lines[fillCount++];
+        item.line.assign(data, len);
+        item.isAction = search(data, data + len, action, action + sizeof(action) - 1) != data + len;
+        if (fillCount == batchSize)
+        {
+            lock_guard<mutex> lock(mtx);
+            submitLocked();
+        }
+    }
+
+    // 提交未满的批次并等待所有已读入的行都被应用（实时模式等待新数据前调用）
+    void drain()
+    {
+        unique_lock<mutex> lock(mtx);
+        submitLocked();
+        slotFreed.wait(lock, [&]() { return nextToApply >= nextToFill; });
+    }
+
+    // 处理完所有剩余数据并结束所有线程
+    void finish()
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            submitLocked();
+            stopping = true;
+        }
+        batchFilled.notify_all();
+        batchDone.notify_all();
+        for (size_t i = 0; i < workers.size(); i++)    workers[i].join();
+        sequencer.join();
+        workers.clear();
+    }
+
+    ~SegmentPipeline()
+    {
+        if (!workers.empty())    finish();
+    }
+};
+
+#endif // SEGMENT_PIPELINE_CPP
@@ -0,0 +1,469 @@
+#ifndef SNAPSHOT_LOG_CPP
+#define SNAPSHOT_LOG_CPP
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "cppjieba/DictImage.hpp"
+#include "symbolTable.cpp"
+
+using namespace std;
+using cppjieba::MappedFile;
+
+/**
+ * 窗口快照日志：把每个时间桶内的 (词编号, 次数) 追加写入紧凑的二进制日志，离线查询不需要重新分词
+ *
+ * 三个文件，都只追加；再次运行时校验头部后续写（桶长度不同时拒绝），日志编号与词典编号分开维护：
+ * - <prefix>.log  头部 8 字节魔数 + 8 字节 bucketSeconds，之后每个桶一条记录：
+ *                 varint(zigzag(桶起始时间)) varint(词数 n)，再是 n 个 varint(编号差值) varint(次数)，编号升序
+ * - <prefix>.idx  头部 8 字节魔数，之后每 indexEvery 条记录一个定长索引项 {int64 桶起始时间, uint64 记录偏移}
+ *                 （本机字节序），时间单调不减，可以 mmap 后二分查找
+ * - <prefix>.dict 按编号顺序的词：varint(字节数) + UTF-8 字节；记录写入前先补齐其中用到的新编号
+ *
+ * 记录按到达顺序写出，桶编号变大时结束当前记录；时间戳早于当前桶的出现并入当前桶，
+ * 因此记录时间单调，索引只需保存时间和偏移
+ */
+static const char SNAPSHOT_LOG_MAGIC[8] = {'H', 'W', 'L', 'O', 'G', '0', '0', '1'};
+static const char SNAPSHOT_IDX_MAGIC[8] = {'H', 'W', 'I', 'D', 'X', '0', '0', '1'};
+
+// 索引项
+struct snapshotIndexEntry
+{
+    int64_t time;
+    uint64_t offset;
+};
+
+inline void PutVarint(string &buf, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buf.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    buf.push_back((char)value);
+}
+
+// 读取一个 varint，数据截断时返回 false
+inline bool GetVarint(const char *&p, const char *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        uint8_t byte = (uint8_t)*p++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))    return true;
+    }
+    return false;
+}
+
+inline uint64_t ZigZag(long long value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+inline long long UnZigZag(uint64_t value)
+{
+    return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+// 把文件截断到 size 字节（丢弃崩溃时写了一半的尾部）
+inline bool TruncateFile(const string &path, uint64_t size)
+{
+#ifdef _WIN32
+    string head(size, '\0');
+    ifstream in(path, ios::binary);
+    if (!in.read(&head[0], (streamsize)size))    return false;
+    in.close();
+    ofstream out(path, ios::binary | ios::trunc);
+    return (bool)out.write(head.data(), (streamsize)head.size());
+#else
+    return truncate(path.c_str(), (off_t)size) == 0;
+#endif
+}
+
+class snapshotLogWriter
+{
+private:
+    static const uint32_t NO_LOG_ID = UINT32_MAX;
+
+    const symbolTable *symbols = nullptr;
+    ofstream log, idx, dict;
+    long long bucketSeconds = 60;
+    size_t indexEvery = 16;
+
+    // 日志有自己的词编号（.dict 中的顺序），可能来自之前的运行，与本次运行的词典编号不同
+    unordered_map<string, uint32_t> logIds; // .dict 中的词 -> 日志编号
+    vector<uint32_t> logIdOf;               // 词典编号 -> 日志编号，NO_LOG_ID 表示还没查过
+    uint32_t dictWords = 0;                 // .dict 中的词数（含 pendingDict）
+    string pendingDict;                     // 已分配日志编号、还没写入 .dict 的词
+
+    // 当前记录：桶编号与按词合并的次数（日志编号）
+    bool hasRecord = false;
+    long long recordBucket = 0;
+    long long firstBucket = LLONG_MIN;      // 续写时已有的最后一条记录的桶，新记录不早于它，保持时间单调
+    vector<pair<uint32_t, int>> counts;
+    vector<unsigned long long> tag; // 词在当前记录中时为 recordSerial
+    vector<uint32_t> pos;
+    unsigned long long recordSerial = 0;
+
+    uint64_t offset = 0;       // 日志当前长度
+    size_t records = 0;        // 本次运行写出的记录数
+    size_t sinceIndex = 0;     // 最后一个索引项之后的记录数（续写时含已有的记录）
+    string buffer;
+
+    long long bucketOf(long long timestamp) const
+    {
+        return timestamp >= 0 ? timestamp / bucketSeconds : -((-timestamp + bucketSeconds - 1) / bucketSeconds);
+    }
+
+    uint32_t logIdFor(uint32_t id)
+    {
+        if (id >= logIdOf.size())    logIdOf.resize(id + 1, (uint32_t)NO_LOG_ID);
+        if (logIdOf[id] != NO_LOG_ID)    return logIdOf[id];
+        const string &word = symbols->word(id);
+        auto found = logIds.find(word);
+        if (found == logIds.end())
+        {
+            found = logIds.insert(make_pair(word, dictWords++)).first;
+            PutVarint(pendingDict, word.size());
+            pendingDict.append(word);
+        }
+        return logIdOf[id] = found->second;
+    }
+
+    // 写出当前记录（及其用到的新词、索引项）
+    void writeRecord()
+    {
+        if (!hasRecord || counts.empty())    return;
+        sort(counts.begin(), counts.end());
+
+        dict.write(pendingDict.data(), pendingDict.size());
+        dict.flush();
+        pendingDict.clear();
+
+        // 续写时已有的记录数可能已经达到（或超过）本次的 indexEvery（上次运行的 indexEvery 更大），
+        // 此时第一条新记录就写索引项，而不是等到记录数恰好是 indexEvery 的倍数
+        if (sinceIndex == 0 || sinceIndex >= indexEvery)
+        {
+            snapshotIndexEntry entry = {(int64_t)(recordBucket * bucketSeconds), offset};
+            idx.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+            sinceIndex = 0;
+        }
+        buffer.clear();
+        PutVarint(buffer, ZigZag(recordBucket * bucketSeconds));
+        PutVarint(buffer, counts.size());
+        uint32_t previous = 0;
+        for (const auto &entry : counts)
+        {
+            PutVarint(buffer, entry.first - previous);
+            PutVarint(buffer, (uint64_t)entry.second);
+            previous = entry.first;
+        }
+        log.write(buffer.data(), buffer.size());
+        log.flush();
+        idx.flush();
+        offset += buffer.size();
+        records++;
+        sinceIndex++;
+        counts.clear();
+    }
+
+    /**
+     * 读取已有的日志以便续写：校验头部和桶长度，载入 .dict，从最后一个索引项开始扫描到日志末尾，
+     * 得到最后一条记录的时间和有效长度；崩溃时写了一半的尾部（记录、索引项、词）被截掉
+     * @return false 如果已有文件不是快照日志或桶长度不同（此时不修改任何文件）
+     */
+    bool resume(const string &prefix, ostream &out)
+    {
+        const uint64_t header = sizeof(SNAPSHOT_LOG_MAGIC) + sizeof(int64_t);
+        MappedFile file;
+        if (!file.Open(prefix + ".log") || file.Size() < header
+            || memcmp(file.Data(), SNAPSHOT_LOG_MAGIC, sizeof(SNAPSHOT_LOG_MAGIC)) != 0)
+        {
+            out << prefix << ".log 不是快照日志，不续写" << endl;
+            return false;
+        }
+        int64_t seconds;
+        memcpy(&seconds, file.Data() + sizeof(SNAPSHOT_LOG_MAGIC), sizeof(seconds));
+        if (seconds != bucketSeconds)
+        {
+            out << prefix << ".log 的桶长度为 " << seconds << " 秒，与 snapshotLogBucketSeconds=" << bucketSeconds
+                << " 不同，不续写" << endl;
+            return false;
+        }
+
+        MappedFile index;
+        if (!index.Open(prefix + ".idx") || index.Size() < sizeof(SNAPSHOT_IDX_MAGIC)
+            || memcmp(index.Data(), SNAPSHOT_IDX_MAGIC, sizeof(SNAPSHOT_IDX_MAGIC)) != 0)
+        {
+            out << prefix << ".idx 缺失或不是快照日志索引，不续写" << endl;
+            return false;
+        }
+        const snapshotIndexEntry *entries = reinterpret_cast<const snapshotIndexEntry *>(index.Data() + sizeof(SNAPSHOT_IDX_MAGIC));
+        size_t entryCount = (index.Size() - sizeof(SNAPSHOT_IDX_MAGIC)) / sizeof(snapshotIndexEntry);
+        while (entryCount > 0 && entries[entryCount - 1].offset >= file.Size())    entryCount--;
+
+        // 从最后一个索引项扫描到末尾，记下最后一条完整记录的结束位置；
+        // 索引项指向的记录本身不完整时丢掉这个索引项，从前一个索引项重新扫描
+        const char *begin = file.Data(), *end = begin + file.Size();
+        uint64_t valid, maxId = 0;
+        bool anyId = false;
+        while (true)
+        {
+            const char *p = begin + (entryCount > 0 ? entries[entryCount - 1].offset : header);
+            valid = (uint64_t)(p - begin);
+            sinceIndex = 0;
+            while (p < end)
+            {
+                uint64_t value, n, id = 0, delta, count;
+                if (!GetVarint(p, end, value) || !GetVarint(p, end, n))    break;
+                uint64_t i = 0;
+                for (; i < n && GetVarint(p, end, delta) && GetVarint(p, end, count); i++)    id += delta;
+                if (i < n)    break;
+                if (n > 0)
+                {
+                    maxId = anyId ? max(maxId, id) : id;
+                    anyId = true;
+                }
+                firstBucket = bucketOf(UnZigZag(value));
+                valid = (uint64_t)(p - begin);
+                sinceIndex++;
+            }
+            if (sinceIndex > 0 || entryCount == 0)    break;
+            entryCount--;
+        }
+
+        // 载入 .dict（没有任何记录时为空文件，无法 mmap）
+        MappedFile words;
+        uint64_t dictValid = 0;
+        if (words.Open(prefix + ".dict"))
+        {
+            const char *q = words.Data(), *dictEnd = q + words.Size();
+            uint64_t length;
+            while (q < dictEnd && GetVarint(q, dictEnd, length) && length <= (uint64_t)(dictEnd - q))
+            {
+                logIds.insert(make_pair(string(q, (size_t)length), dictWords++));
+                q += length;
+                dictValid = (uint64_t)(q - words.Data());
+            }
+        }
+        if (anyId && maxId >= dictWords)
+        {
+            out << prefix << ".dict 缺少日志中用到的词，不续写" << endl;
+            return false;
+        }
+
+        uint64_t logSize = file.Size(), idxSize = index.Size(), dictSize = words.Size();
+        uint64_t idxValid = sizeof(SNAPSHOT_IDX_MAGIC) + entryCount * sizeof(snapshotIndexEntry);
+        file.Close();
+        index.Close();
+        words.Close();
+        if ((valid < logSize && !TruncateFile(prefix + ".log", valid))
+            || (idxValid < idxSize && !TruncateFile(prefix + ".idx", idxValid))
+            || (dictValid < dictSize && !TruncateFile(prefix + ".dict", dictValid)))
+        {
+            out << "无法截掉 " << prefix << " 末尾不完整的数据，不续写" << endl;
+            return false;
+        }
+        offset = valid;
+        if (valid < logSize || idxValid < idxSize || dictValid < dictSize)
+        {
+            out << "快照日志 " << prefix << " 末尾有不完整的数据（上次未正常结束），已截掉" << endl;
+        }
+        return true;
+    }
+
+public:
+    /**
+     * 打开日志文件：不存在时创建，已存在时校验头部后续写（桶长度不同时拒绝）
+     * @param indexEvery 每多少条记录写一个索引项
+     */
+    bool open(const string &prefix, const symbolTable &symbols, long long bucketSeconds, size_t indexEvery, ostream &out)
+    {
+        this->symbols = &symbols;
+        this->bucketSeconds = bucketSeconds > 0 ? bucketSeconds : 1;
+        this->indexEvery = indexEvery > 0 ? indexEvery : 1;
+        bool exists = ifstream(prefix + ".log", ios::binary).peek() != char_traits<char>::eof();
+        if (exists)
+        {
+            if (!resume(prefix, out))    return false;
+            log.open(prefix + ".log", ios::binary | ios::app);
+            idx.open(prefix + ".idx", ios::binary | ios::app);
+            dict.open(prefix + ".dict", ios::binary | ios::app);
+            if (log.is_open() && idx.is_open() && dict.is_open())
+            {
+                out << "续写快照日志 " << prefix << "：已有 " << dictWords << " 个词" << endl;
+            }
+            return log.is_open() && idx.is_open() && dict.is_open();
+        }
+        log.open(prefix + ".log", ios::binary | ios::trunc);
+        idx.open(prefix + ".idx", ios::binary | ios::trunc);
+        dict.open(prefix + ".dict", ios::binary | ios::trunc);
+        if (!log.is_open() || !idx.is_open() || !dict.is_open())    return false;
+        int64_t seconds = this->bucketSeconds;
+        log.write(SNAPSHOT_LOG_MAGIC, sizeof(SNAPSHOT_LOG_MAGIC));
+        log.write(reinterpret_cast<const char *>(&seconds), sizeof(seconds));
+        idx.write(SNAPSHOT_IDX_MAGIC, sizeof(SNAPSHOT_IDX_MAGIC));
+        offset = sizeof(SNAPSHOT_LOG_MAGIC) + sizeof(seconds);
+        return true;
+    }
+
+    // 记录一次出现
+    void add(uint32_t id, long long timestamp)
+    {
+        long long b = max(bucketOf(timestamp), firstBucket);
+        if (!hasRecord || b > recordBucket)
+        {
+            writeRecord();
+            hasRecord = true;
+            recordBucket = b;
+            recordSerial++;
+        }
+        if (id >= tag.size())
+        {
+            tag.resize(id + 1, 0);
+            pos.resize(id + 1, 0);
+        }
+        if (tag[id] == recordSerial)
+        {
+            counts[pos[id]].second++;
+            return;
+        }
+        tag[id] = recordSerial;
+        pos[id] = (uint32_t)counts.size();
+        counts.push_back(make_pair(logIdFor(id), 1));
+    }
+
+    // 对当前记录中的词（词典编号）调用 f，用于编号回收
+    template <class F>
+    void forEachId(F &&f) const
+    {
+        if (!hasRecord)    return;
+        for (uint32_t id = 0; id < tag.size(); id++)
+        {
+            if (tag[id] == recordSerial)    f(id);
+        }
+    }
+
+    // 词典编号被回收：之后复用该编号的新词重新查找日志编号
+    void forget(uint32_t id)
+    {
+        if (id < logIdOf.size())    logIdOf[id] = NO_LOG_ID;
+    }
+
+    // 写出尚未结束的记录（程序结束时调用）
+    void finish()
+    {
+        writeRecord();
+        hasRecord = false;
+    }
+
+    // 本次运行写出的记录数
+    size_t recordCount() const
+    {
+        return records;
+    }
+};
+
+/**
+ * 离线读取快照日志：mmap 三个文件，在索引上二分查找起点，只扫描与时间范围相交的记录
+ */
+class snapshotLogReader
+{
+private:
+    MappedFile log, idx, dict;
+    vector<string> words;
+    long long bucketSeconds = 1;
+
+public:
+    bool open(const string &prefix)
+    {
+        if (!log.Open(prefix + ".log") || log.Size() < sizeof(SNAPSHOT_LOG_MAGIC) + sizeof(int64_t)
+            || memcmp(log.Data(), SNAPSHOT_LOG_MAGIC, sizeof(SNAPSHOT_LOG_MAGIC)) != 0)
+        {
+            return false;
+        }
+        int64_t seconds;
+        memcpy(&seconds, log.Data() + sizeof(SNAPSHOT_LOG_MAGIC), sizeof(seconds));
+        bucketSeconds = seconds;
+        if (!idx.Open(prefix + ".idx") || idx.Size() < sizeof(SNAPSHOT_IDX_MAGIC)
+            || memcmp(idx.Data(), SNAPSHOT_IDX_MAGIC, sizeof(SNAPSHOT_IDX_MAGIC)) != 0)
+        {
+            return false;
+        }
+        // 没有任何记录时 .dict 为空文件，无法 mmap
+        if (dict.Open(prefix + ".dict"))
+        {
+            const char *p = dict.Data(), *end = p + dict.Size();
+            uint64_t length;
+            while (p < end && GetVarint(p, end, length) && length <= (uint64_t)(end - p))
+            {
+                words.push_back(string(p, (size_t)length));
+                p += length;
+            }
+        }
+        return true;
+    }
+
+    long long bucketLength() const
+    {
+        return bucketSeconds;
+    }
+
+    const string &word(uint32_t id) const
+    {
+        return words[id];
+    }
+
+    size_t wordCount() const
+    {
+        return words.size();
+    }
+
+    /**
+     * 对时间范围 [from, to] 内（与桶相交即算）每条记录的每个 (词编号, 次数) 调用 f
+     * 二分查找 O(log 索引项数)，之后最多多扫描 indexEvery 条记录
+     */
+    template <class F>
+    void scan(long long from, long long to, F &&f) const
+    {
+        const snapshotIndexEntry *entries = reinterpret_cast<const snapshotIndexEntry *>(idx.Data() + sizeof(SNAPSHOT_IDX_MAGIC));
+        size_t entryCount = (idx.Size() - sizeof(SNAPSHOT_IDX_MAGIC)) / sizeof(snapshotIndexEntry);
+        // 最后一个完全早于 from 的索引项：它之前的记录都不相交
+        const snapshotIndexEntry *first = upper_bound(entries, entries + entryCount, from - bucketSeconds,
+            [](long long time, const snapshotIndexEntry &entry) { return time < entry.time; });
+        uint64_t offset = first == entries ? sizeof(SNAPSHOT_LOG_MAGIC) + sizeof(int64_t) : (first - 1)->offset;
+
+        const char *p = log.Data() + offset, *end = log.Data() + log.Size();
+        while (p < end)
+        {
+            uint64_t value, n;
+            if (!GetVarint(p, end, value) || !GetVarint(p, end, n))    return;
+            long long time = UnZigZag(value);
+            if (time > to)    return;
+            bool inRange = time + bucketSeconds > from;
+            uint64_t id = 0;
+            for (uint64_t i = 0; i < n; i++)
+            {
+                uint64_t delta, count;
+                if (!GetVarint(p, end, delta) || !GetVarint(p, end, count))    return;
+                id += delta;
+                if (inRange)    f((uint32_t)id, (long long)count);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,364 @@
+#ifndef STREAM_SUMMARY_CPP
+#define STREAM_SUMMARY_CPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Stream-Summary 结构：按计数分桶的双向链表，随计数变化增量维护 Top-K
+ * 计数桶按计数从小到大链成双向链表，每个桶内挂着计数相同的词（同样是双向链表）
+ * 加一 / 减一只需把词移到相邻的桶，O(1)；一次增减 n 最多跨过 n 个桶
+ * 任意 K 的查询从计数最大的桶开始向下遍历，O(K)，与词表大小无关
+ * 词以 symbolTable 的稠密编号索引，计数为 0 的词不在结构中
+ */
+class streamSummary
+{
+private:
+    enum : uint32_t { NIL = 0xFFFFFFFFu };
+
+    struct countBucket
+    {
+        int count;
+        uint32_t first;      // 桶内第一个词
+        uint32_t prev, next; // 计数更小 / 更大的相邻桶
+    };
+
+    vector<countBucket> buckets;
+    vector<uint32_t> freeBuckets;
+    uint32_t lowest = NIL, highest = NIL;
+
+    // 按词编号索引：所在桶、桶内的前后词
+    vector<uint32_t> bucketOf, prevItem, nextItem;
+    size_t items = 0;
+
+    void ensure(uint32_t id)
+    {
+        if (id >= bucketOf.size())
+        {
+            bucketOf.resize(id + 1, NIL);
+            prevItem.resize(id + 1, NIL);
+            nextItem.resize(id + 1, NIL);
+        }
+    }
+
+    // 在 prev 和 next 之间插入一个计数为 count 的空桶
+    uint32_t newBucket(int count, uint32_t prev, uint32_t next)
+    {
+        uint32_t b;
+        if (!freeBuckets.empty())
+        {
+            b = freeBuckets.back();
+            freeBuckets.pop_back();
+        }
+        else
+        {
+            b = (uint32_t)buckets.size();
+            buckets.push_back(countBucket());
+        }
+        buckets[b].count = count;
+        buckets[b].first = NIL;
+        buckets[b].prev = prev;
+        buckets[b].next = next;
+        if (prev != NIL)    buckets[prev].next = b;
+        else    lowest = b;
+        if (next != NIL)    buckets[next].prev = b;
+        else    highest = b;
+        return b;
+    }
+
+    // 桶空了就从桶链表中摘除
+    void freeIfEmpty(uint32_t b)
+    {
+        if (buckets[b].first != NIL)    return;
+        uint32_t prev = buckets[b].prev, next = buckets[b].next;
+        if (prev != NIL)    buckets[prev].next = next;
+        else    lowest = next;
+        if (next != NIL)    buckets[next].prev = prev;
+        else    highest = prev;
+        freeBuckets.push_back(b);
+    }
+
+    void attach(uint32_t id, uint32_t b)
+    {
+        uint32_t first = buckets[b].first;
+        prevItem[id] = NIL;
+        nextItem[id] = first;
+        if (first != NIL)    prevItem[first] = id;
+        buckets[b].first = id;
+        bucketOf[id] = b;
+    }
+
+    void detach(uint32_t id)
+    {
+        uint32_t b = bucketOf[id];
+        if (prevItem[id] != NIL)    nextItem[prevItem[id]] = nextItem[id];
+        else    buckets[b].first = nextItem[id];
+        if (nextItem[id] != NIL)    prevItem[nextItem[id]] = prevItem[id];
+        bucketOf[id] = NIL;
+    }
+
+public:
+    // 词的计数加 by（by > 0）
+    void increment(uint32_t id, int by = 1)
+    {
+        if (by <= 0)    return;
+        ensure(id);
+        uint32_t b = bucketOf[id];
+        int target = (b == NIL ? 0 : buckets[b].count) + by;
+        // 找到 prev.count <= target < next.count 的位置
+        uint32_t prev = b;
+        uint32_t next = (b == NIL) ? lowest : buckets[b].next;
+        while (next != NIL && buckets[next].count <= target)
+        {
+            prev = next;
+            next = buckets[next].next;
+        }
+        uint32_t dest = (prev != NIL && buckets[prev].count == target) ? prev : newBucket(target, prev, next);
+        if (b != NIL)
+        {
+            detach(id);
+            freeIfEmpty(b);
+        }
+        else
+        {
+            items++;
+        }
+        attach(id, dest);
+    }
+
+    // 词的计数减 by（by > 0），减到 0 时移出结构
+    void decrement(uint32_t id, int by = 1)
+    {
+        uint32_t b = id < bucketOf.size() ? bucketOf[id] : NIL;
+        if (b == NIL || by <= 0)    return;
+        int target = buckets[b].count - by;
+        if (target <= 0)
+        {
+            detach(id);
+            freeIfEmpty(b);
+            items--;
+            return;
+        }
+        // 找到 prev.count < target <= next.count 的位置
+        uint32_t next = b;
+        uint32_t prev = buckets[b].prev;
+        while (prev != NIL && buckets[prev].count >= target)
+        {
+            next = prev;
+            prev = buckets[prev].prev;
+        }
+        uint32_t dest = (buckets[next].count == target) ? next : newBucket(target, prev, next);
+        detach(id);
+        freeIfEmpty(b);
+        attach(id, dest);
+    }
+
+    int count(uint32_t id) const
+    {
+        if (id >= bucketOf.size() || bucketOf[id] == NIL)    return 0;
+        return buckets[bucketOf[id]].count;
+    }
+
+    // 计数最小的词之一，结构为空时返回 UINT32_MAX
+    uint32_t minItem() const
+    {
+        return lowest == NIL ? UINT32_MAX : buckets[lowest].first;
+    }
+
+    // 把词的计数直接设为 value（value <= 0 时移出结构）
+    void set(uint32_t id, int value)
+    {
+        int current = count(id);
+        if (value > current)    increment(id, value - current);
+        else if (value < current)    decrement(id, current - value);
+    }
+
+    // 计数大于 0 的词数
+    size_t size() const
+    {
+        return items;
+    }
+
+    // 按计数从大到小取前 k 个 (词编号, 次数)
+    void topK(size_t k, vector<pair<uint32_t, int>> &result) const
+    {
+        result.clear();
+        for (uint32_t b = highest; b != NIL && result.size() < k; b = buckets[b].prev)
+        {
+            for (uint32_t id = buckets[b].first; id != NIL && result.size() < k; id = nextItem[id])
+            {
+                result.push_back(make_pair(id, buckets[b].count));
+            }
+        }
+    }
+};
+
+/**
+ * 容量固定的 Stream-Summary：最多保存 capacity 个词，词编号经开放寻址的哈希表映射到 [0, capacity) 的槽位，
+ * 内部的 Stream-Summary 按槽位索引，内存只与 capacity 有关，与词表大小无关
+ * 哈希表的大小为不小于 2 × capacity 的 2 的幂，线性探测，删除时把后面的项前移（不留墓碑）
+ * 接口与 streamSummary 相同；结构已满时新词的 increment 被忽略，调用方需先移出一个词
+ */
+class boundedSummary
+{
+private:
+    enum : uint32_t { EMPTY = 0xFFFFFFFFu };
+
+    size_t capacity;
+    streamSummary summary;     // 按槽位索引
+    vector<uint32_t> slotWord; // 槽位 -> 词编号
+    vector<uint32_t> freeSlots;
+    vector<uint32_t> keys;     // 哈希表：词编号，EMPTY 表示空
+    vector<uint32_t> values;   // 哈希表：槽位
+    size_t mask;
+
+    size_t home(uint32_t id) const
+    {
+        return (size_t)((id * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    }
+
+    size_t find(uint32_t id) const
+    {
+        size_t i = home(id);
+        while (keys[i] != EMPTY && keys[i] != id)    i = (i + 1) & mask;
+        return i;
+    }
+
+    // 词的计数变为 0 后释放槽位和哈希表中的项
+    void release(uint32_t id, uint32_t slot)
+    {
+        freeSlots.push_back(slot);
+        size_t i = find(id);
+        keys[i] = EMPTY;
+        // 把探测链上后面的项前移到空位，保证查找不会提前遇到空位
+        for (size_t j = (i + 1) & mask; keys[j] != EMPTY; j = (j + 1) & mask)
+        {
+            size_t h = home(keys[j]);
+            if (((j - h) & mask) >= ((j - i) & mask))
+            {
+                keys[i] = keys[j];
+                values[i] = values[j];
+                keys[j] = EMPTY;
+                i = j;
+            }
+        }
+    }
+
+public:
+    static const uint32_t NONE = 0xFFFFFFFFu;
+
+    explicit boundedSummary(size_t capacity)
+        : capacity(capacity > 0 ? capacity : 1), slotWord(this->capacity, EMPTY)
+    {
+        size_t size = 2;
+        while (size < this->capacity * 2)    size *= 2;
+        keys.assign(size, EMPTY);
+        values.assign(size, 0);
+        mask = size - 1;
+        for (size_t slot = this->capacity; slot > 0; slot--)    freeSlots.push_back((uint32_t)(slot - 1));
+    }
+
+    // 词所在的槽位，不在结构中时返回 NONE；调用方可以按槽位保存每个词的附加信息
+    uint32_t slotOf(uint32_t id) const
+    {
+        size_t i = find(id);
+        return keys[i] == EMPTY ? NONE : values[i];
+    }
+
+    void increment(uint32_t id, int by = 1)
+    {
+        if (by <= 0)    return;
+        uint32_t slot = slotOf(id);
+        if (slot == NONE)
+        {
+            if (freeSlots.empty())    return;
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            slotWord[slot] = id;
+            size_t i = find(id);
+            keys[i] = id;
+            values[i] = slot;
+        }
+        summary.increment(slot, by);
+    }
+
+    void decrement(uint32_t id, int by = 1)
+    {
+        uint32_t slot = slotOf(id);
+        if (slot == NONE || by <= 0)    return;
+        summary.decrement(slot, by);
+        if (summary.count(slot) == 0)    release(id, slot);
+    }
+
+    int count(uint32_t id) const
+    {
+        uint32_t slot = slotOf(id);
+        return slot == NONE ? 0 : summary.count(slot);
+    }
+
+    uint32_t minItem() const
+    {
+        uint32_t slot = summary.minItem();
+        return slot == UINT32_MAX ? UINT32_MAX : slotWord[slot];
+    }
+
+    void set(uint32_t id, int value)
+    {
+        int current = count(id);
+        if (value > current)    increment(id, value - current);
+        else if (value < current)    decrement(id, current - value);
+    }
+
+    size_t size() const
+    {
+        return summary.size();
+    }
+
+    // 对结构中的每个词编号调用 f，O(capacity)
+    template <class F>
+    void forEach(F &&f) const
+    {
+        for (uint32_t key : keys)
+        {
+            if (key != EMPTY)    f(key);
+        }
+    }
+
+    void topK(size_t k, vector<pair<uint32_t, int>> &result) const
+    {
+        summary.topK(k, result);
+        for (auto &entry : result)    entry.first = slotWord[entry.first];
+    }
+
+    // 保存到检查点：按 topK 的顺序写出所有 (词编号, 次数)
+    template <class Writer>
+    void save(Writer &writer) const
+    {
+        vector<pair<uint32_t, int>> entries;
+        topK(size(), entries);
+        writer.putVector(entries);
+    }
+
+    /**
+     * 从检查点恢复到空结构：倒序插入，新词挂在计数桶的链表头，
+     * 恢复后同计数的词的顺序（决定 minItem 顶替哪个词）与保存时相同
+     */
+    template <class Reader>
+    bool load(Reader &reader)
+    {
+        vector<pair<uint32_t, int>> entries;
+        if (!reader.getVector(entries) || entries.size() > capacity || size() != 0)    return false;
+        for (size_t i = entries.size(); i > 0; i--)
+        {
+            const auto &entry = entries[i - 1];
+            if (entry.second <= 0 || slotOf(entry.first) != NONE)    return false;
+            increment(entry.first, entry.second);
+        }
+        return true;
+    }
+};
+
+#endif
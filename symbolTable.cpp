@@ -0,0 +1,128 @@
+#ifndef SYMBOL_TABLE_CPP
+#define SYMBOL_TABLE_CPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * 符号表：把词映射为稠密的 uint32_t 编号
+ * 每个不同的词只保存一份字符串，计数器、窗口和迟到缓冲区只保存编号，
+ * 一次出现只需一次字符串哈希，之后的计数与过期都是数组下标访问
+ * 编号可以回收（release）：不再被任何窗口、缓冲区或统计引用的词由 hotWord 定期释放，
+ * 编号优先分配给之后的新词，因此编号上界（以及按编号索引的数组）随同时在用的词数而不是历史词数增长
+ * 不是线程安全的：只能在计数阶段（按输入顺序的单线程）中调用 intern / release
+ */
+class symbolTable
+{
+private:
+    unordered_map<string, uint32_t> ids;
+    vector<const string *> words; // 编号 -> 词，指向 ids 中的键（节点地址稳定）；已回收的编号为 nullptr
+    vector<uint32_t> freeIds;     // 已回收、可以重新分配的编号（后进先出）
+
+public:
+    static const uint32_t NONE = UINT32_MAX;
+
+    // 返回词的编号，首次出现时分配编号（优先复用已回收的编号），此时 added 为 true
+    uint32_t intern(const string &word, bool &added)
+    {
+        auto it = ids.find(word);
+        added = it == ids.end();
+        if (!added)    return it->second;
+        uint32_t id;
+        if (!freeIds.empty())
+        {
+            id = freeIds.back();
+            freeIds.pop_back();
+        }
+        else
+        {
+            id = (uint32_t)words.size();
+            words.push_back(nullptr);
+        }
+        it = ids.emplace(word, id).first;
+        words[id] = &it->first;
+        return id;
+    }
+
+    // 查找词的编号，不存在时返回 NONE
+    uint32_t find(const string &word) const
+    {
+        auto it = ids.find(word);
+        if (it == ids.end())    return NONE;
+        return it->second;
+    }
+
+    // 编号对应的词；已回收的编号返回空串
+    const string &word(uint32_t id) const
+    {
+        static const string empty;
+        return words[id] != nullptr ? *words[id] : empty;
+    }
+
+    bool live(uint32_t id) const
+    {
+        return words[id] != nullptr;
+    }
+
+    // 回收编号：调用方保证该编号不再被任何结构引用
+    void release(uint32_t id)
+    {
+        if (words[id] == nullptr)    return;
+        ids.erase(ids.find(*words[id]));
+        words[id] = nullptr;
+        freeIds.push_back(id);
+    }
+
+    // 编号上界（含已回收的编号）
+    size_t size() const
+    {
+        return words.size();
+    }
+
+    // 在用的词数
+    size_t liveCount() const
+    {
+        return words.size() - freeIds.size();
+    }
+
+    /**
+     * 保存到检查点：按编号顺序的词（已回收的编号为空串）和待复用的编号，恢复后编号分配与不中断时相同
+     */
+    template <class Writer>
+    void save(Writer &writer) const
+    {
+        writer.put((uint64_t)words.size());
+        for (uint32_t id = 0; id < words.size(); id++)    writer.putString(word(id));
+        writer.putVector(freeIds);
+    }
+
+    // 从检查点恢复，只能在分配任何编号之前调用；onWord(编号, 词) 对每个在用的词调用一次
+    template <class Reader, class OnWord>
+    bool load(Reader &reader, OnWord &&onWord)
+    {
+        uint64_t count;
+        if (!reader.get(count))    return false;
+        string text;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            if (!reader.getString(text))    return false;
+            words.push_back(nullptr);
+            if (text.empty())    continue;
+            auto it = ids.emplace(text, (uint32_t)i).first;
+            words[(size_t)i] = &it->first;
+            onWord((uint32_t)i, it->first);
+        }
+        if (!reader.getVector(freeIds))    return false;
+        for (uint32_t id : freeIds)
+        {
+            if (id >= words.size() || words[id] != nullptr)    return false;
+        }
+        return freeIds.size() + ids.size() == words.size();
+    }
+};
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef TIME_ROLLUP_CPP
+#define TIME_ROLLUP_CPP
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// 一份汇总：(词编号, 次数)，按编号升序，两份汇总可以线性合并
+typedef vector<pair<uint32_t, int>> rollupSummary;
+
+/**
+ * 分层时间汇总：为每分钟、每小时、每天各保存一份已结束时段的 (词编号, 次数) 汇总，
+ * 历史时间段的 Top-K 只需合并覆盖该时段的 O(天数 + 24 + 60) 份汇总，不需要重新分词
+ *
+ * 只有当前分钟按出现逐个累积；分钟结束时排序后存档并合并进当前小时，小时结束时存档并合并进当前天，
+ * 因此每份汇总只在结束时合并一次。与窗口快照日志相同，时间戳早于当前分钟的出现并入当前分钟
+ * 时间按 Unix 秒或当天秒数，天以 0 点（UTC）为界
+ *
+ * 分钟 / 小时汇总并入小时 / 天之后只保留最近 minuteRetention 分钟 / hourRetention 小时（0 表示一直保留），
+ * 更早的时段按所在的整小时 / 整天回答（时段边界向外取整）；天汇总一直保留，每天一份
+ */
+class timeRollup
+{
+private:
+    enum { MINUTE = 60, MINUTES_PER_HOUR = 60, MINUTES_PER_DAY = 1440 };
+
+    // 已结束的汇总，键为分钟 / 小时 / 天的编号
+    map<long long, rollupSummary> minutes, hours, days;
+
+    // 当前分钟：按词合并的次数（未排序）
+    bool started = false;
+    long long openMinute = 0;
+    rollupSummary openCounts;
+    vector<unsigned long long> tag; // 词在当前分钟中时为 serial
+    vector<uint32_t> pos;
+    unsigned long long serial = 0;
+
+    // 当前小时 / 当前天：已结束的分钟 / 小时合并后的汇总
+    long long openHour = 0, openDay = 0;
+    rollupSummary hourCounts, dayCounts;
+
+    // 保留期与清理进度：早于 minuteFloor 的分钟、早于 hourFloor 的小时已被清理
+    long long minuteRetention, hourRetention;
+    long long firstMinute = 0;
+    long long minuteFloor = LLONG_MIN, hourFloor = LLONG_MIN;
+
+    static long long floorDiv(long long value, long long unit)
+    {
+        return value >= 0 ? value / unit : -((-value + unit - 1) / unit);
+    }
+
+    // 把 from 合并进 into（都按编号升序）
+    static void merge(rollupSummary &into, const rollupSummary &from)
+    {
+        if (from.empty())    return;
+        rollupSummary merged;
+        merged.reserve(into.size() + from.size());
+        size_t i = 0, j = 0;
+        while (i < into.size() || j < from.size())
+        {
+            if (j == from.size() || (i < into.size() && into[i].first < from[j].first))    merged.push_back(into[i++]);
+            else if (i == into.size() || from[j].first < into[i].first)    merged.push_back(from[j++]);
+            else
+            {
+                merged.push_back(make_pair(into[i].first, into[i].second + from[j].second));
+                i++;
+                j++;
+            }
+        }
+        into.swap(merged);
+    }
+
+    // 结束当前分钟，进入分钟 next：依次存档分钟、（跨小时时）小时、（跨天时）天
+    void advance(long long next)
+    {
+        if (!openCounts.empty())
+        {
+            sort(openCounts.begin(), openCounts.end());
+            merge(hourCounts, openCounts);
+            minutes[openMinute].swap(openCounts);
+            openCounts.clear();
+        }
+        openMinute = next;
+        serial++;
+        long long hour = floorDiv(next, MINUTES_PER_HOUR);
+        if (hour != openHour)
+        {
+            if (!hourCounts.empty())
+            {
+                merge(dayCounts, hourCounts);
+                hours[openHour].swap(hourCounts);
+                hourCounts.clear();
+            }
+            openHour = hour;
+        }
+        long long day = floorDiv(next, MINUTES_PER_DAY);
+        if (day != openDay)
+        {
+            if (!dayCounts.empty())
+            {
+                days[openDay].swap(dayCounts);
+                dayCounts.clear();
+            }
+            openDay = day;
+        }
+        prune();
+    }
+
+    // 清理超出保留期、且已并入更粗一级汇总的分钟 / 小时
+    void prune()
+    {
+        while (minuteRetention > 0 && !minutes.empty() && minutes.begin()->first < openMinute - minuteRetention
+               && floorDiv(minutes.begin()->first, MINUTES_PER_HOUR) < openHour)
+        {
+            minuteFloor = minutes.begin()->first + 1;
+            minutes.erase(minutes.begin());
+        }
+        while (hourRetention > 0 && !hours.empty() && hours.begin()->first < openHour - hourRetention
+               && floorDiv(hours.begin()->first, MINUTES_PER_DAY / MINUTES_PER_HOUR) < openDay)
+        {
+            hourFloor = hours.begin()->first + 1;
+            hours.erase(hours.begin());
+        }
+    }
+
+    template <class F>
+    static void visit(const map<long long, rollupSummary> &tier, long long key, F &f)
+    {
+        auto it = tier.find(key);
+        if (it == tier.end())    return;
+        for (const auto &entry : it->second)    f(entry.first, entry.second);
+    }
+
+public:
+    explicit timeRollup(long long minuteRetention = 0, long long hourRetention = 0)
+        : minuteRetention(max(minuteRetention, 0LL)), hourRetention(max(hourRetention, 0LL)) {}
+
+    // 记录一次出现，O(1)（分钟结束时摊还 O(该分钟的不同词数 × log)）
+    void add(uint32_t id, long long timestamp)
+    {
+        long long minute = floorDiv(timestamp, MINUTE);
+        if (!started)
+        {
+            started = true;
+            firstMinute = minute;
+            openMinute = minute;
+            openHour = floorDiv(minute, MINUTES_PER_HOUR);
+            openDay = floorDiv(minute, MINUTES_PER_DAY);
+            serial++;
+        }
+        else if (minute > openMinute)
+        {
+            advance(minute);
+        }
+        if (id >= tag.size())
+        {
+            tag.resize(id + 1, 0);
+            pos.resize(id + 1, 0);
+        }
+        if (tag[id] == serial)
+        {
+            openCounts[pos[id]].second++;
+            return;
+        }
+        tag[id] = serial;
+        pos[id] = (uint32_t)openCounts.size();
+        openCounts.push_back(make_pair(id, 1));
+    }
+
+    /**
+     * 对与 [from, to) 相交的每一分钟内的每个 (词编号, 次数) 调用 f（同一个词可能出现多次）
+     * 整天、整小时且已结束的部分直接使用天 / 小时汇总，其余逐分钟合并；
+     * 已清理的分钟 / 小时使用其所在的整小时 / 整天
+     * @return 合并的汇总份数（包括空的）
+     */
+    template <class F>
+    size_t query(long long from, long long to, F &&f) const
+    {
+        if (!started || from >= to)    return 0;
+        long long lo = max(floorDiv(from, MINUTE), firstMinute);
+        long long hi = min(floorDiv(to - 1, MINUTE) + 1, openMinute + 1);
+        size_t merged = 0;
+        for (long long m = lo; m < hi; merged++)
+        {
+            long long day = floorDiv(m, MINUTES_PER_DAY), hour = floorDiv(m, MINUTES_PER_HOUR);
+            if ((m == day * MINUTES_PER_DAY && m + MINUTES_PER_DAY <= hi && day < openDay) || hour < hourFloor)
+            {
+                visit(days, day, f);
+                m = (day + 1) * MINUTES_PER_DAY;
+            }
+            else if ((m == hour * MINUTES_PER_HOUR && m + MINUTES_PER_HOUR <= hi && hour < openHour) || m < minuteFloor)
+            {
+                visit(hours, hour, f);
+                m = (hour + 1) * MINUTES_PER_HOUR;
+            }
+            else
+            {
+                if (m == openMinute)
+                {
+                    for (const auto &entry : openCounts)    f(entry.first, entry.second);
+                }
+                else    visit(minutes, m, f);
+                m++;
+            }
+        }
+        return merged;
+    }
+
+    // 对所有保留的汇总和当前分钟中的每个词编号调用 f（同一个词可能多次），用于编号回收
+    template <class F>
+    void forEachId(F &&f) const
+    {
+        const map<long long, rollupSummary> *tiers[] = {&minutes, &hours, &days};
+        for (const auto *tier : tiers)
+        {
+            for (const auto &entry : *tier)
+            {
+                for (const auto &count : entry.second)    f(count.first);
+            }
+        }
+        const rollupSummary *open[] = {&openCounts, &hourCounts, &dayCounts};
+        for (const auto *counts : open)
+        {
+            for (const auto &count : *counts)    f(count.first);
+        }
+    }
+
+    size_t minuteCount() const
+    {
+        return minutes.size();
+    }
+
+    size_t hourCount() const
+    {
+        return hours.size();
+    }
+
+    size_t dayCount() const
+    {
+        return days.size();
+    }
+
+    // 保存到检查点
+    template <class Writer>
+    void save(Writer &writer) const
+    {
+        writer.put(started);
+        writer.put(openMinute);
+        writer.put(openHour);
+        writer.put(openDay);
+        writer.putVector(openCounts);
+        writer.putVector(hourCounts);
+        writer.putVector(dayCounts);
+        writer.put(firstMinute);
+        writer.put(minuteFloor);
+        writer.put(hourFloor);
+        const map<long long, rollupSummary> *tiers[] = {&minutes, &hours, &days};
+        for (const auto *tier : tiers)
+        {
+            writer.put((uint64_t)tier->size());
+            for (const auto &entry : *tier)
+            {
+                writer.put(entry.first);
+                writer.putVector(entry.second);
+            }
+        }
+    }
+
+    // 从检查点恢复
+    template <class Reader>
+    bool load(Reader &reader)
+    {
+        if (!reader.get(started) || !reader.get(openMinute) || !reader.get(openHour) || !reader.get(openDay)
+            || !reader.getVector(openCounts) || !reader.getVector(hourCounts) || !reader.getVector(dayCounts)
+            || !reader.get(firstMinute) || !reader.get(minuteFloor) || !reader.get(hourFloor))
+        {
+            return false;
+        }
+        map<long long, rollupSummary> *tiers[] = {&minutes, &hours, &days};
+        for (auto *tier : tiers)
+        {
+            uint64_t count;
+            if (!reader.get(count))    return false;
+            tier->clear();
+            for (uint64_t i = 0; i < count; i++)
+            {
+                long long key;
+                if (!reader.get(key) || !reader.getVector((*tier)[key]))    return false;
+            }
+        }
+        prune();
+        serial++;
+        for (uint32_t i = 0; i < openCounts.size(); i++)
+        {
+            uint32_t id = openCounts[i].first;
+            if (id >= tag.size())
+            {
+                tag.resize(id + 1, 0);
+                pos.resize(id + 1, 0);
+            }
+            tag[id] = serial;
+            pos[id] = i;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef TIMESTAMP_PARSER_CPP
+#define TIMESTAMP_PARSER_CPP
+
+#include <cstddef>
+
+/**
+ * 时间戳解析器
+ *
+ * 直接在原始字节上解析，不构造 substr / istringstream，也不分配任何内存。
+ * 支持以下格式（两侧必须有方括号）：
+ * - [H:MM:SS]                      当天时间，返回秒数（小时数不限，不会在午夜回绕）
+ * - [1735372800]                   Unix 秒（不超过 11 位数字）
+ * - [1735372800123]                Unix 毫秒（12 位及以上数字），向下取整到秒
+ * - [2025-12-28T10:00:00]          ISO-8601，日期与时间之间也可用空格，
+ *   [2025-12-28T10:00:00.123+08:00] 可带小数秒和时区（Z、±HH:MM、±HHMM），返回 Unix 秒，
+ *   早于 1970-01-01T00:00:00Z 的时间视为格式错误
+ * 解析失败返回 -1（合法的时间戳都不小于 0）。
+ */
+
+// 整数部分最多的位数，18 位十进制数不会超出 long long
+static const size_t MAX_DIGITS = 18;
+// H:MM:SS 每一段的上限，换算成秒后相加不会超出 long long
+static const long long MAX_CLOCK_FIELD = 1000000000000000LL;
+
+// 读取连续的十进制数字，返回读取的位数，结果写入 value；超过 MAX_DIGITS 位时返回 0（按格式错误处理）
+inline size_t ReadDigits(const char *p, const char *end, long long &value)
+{
+    const char *start = p;
+    long long v = 0;
+    while (p < end && (unsigned)(*p - '0') < 10)
+    {
+        if ((size_t)(p - start) == MAX_DIGITS)    return 0;
+        v = v * 10 + (*p - '0');
+        p++;
+    }
+    value = v;
+    return p - start;
+}
+
+// 跳过连续的十进制数字（位数不限，不计算数值），返回跳过的位数
+inline size_t SkipDigits(const char *p, const char *end)
+{
+    const char *start = p;
+    while (p < end && (unsigned)(*p - '0') < 10)    p++;
+    return p - start;
+}
+
+// 读取恰好 n 位数字，不足 n 位返回 -1
+inline int ReadFixedDigits(const char *p, const char *end, int n)
+{
+    if (end - p < n)    return -1;
+    int v = 0;
+    for (int i = 0; i < n; i++)
+    {
+        unsigned d = (unsigned)(p[i] - '0');
+        if (d >= 10)    return -1;
+        v = v * 10 + (int)d;
+    }
+    return v;
+}
+
+// 公历日期转换为自 1970-01-01 起的天数（Howard Hinnant 的 days_from_civil 算法）
+inline long long DaysFromCivil(long long y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    const long long era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (long long)doe - 719468;
+}
+
+// 解析 ISO-8601 日期时间（p 指向年份的第一位）
+inline long long ParseIso8601(const char *p, const char *end)
+{
+    int year = ReadFixedDigits(p, end, 4);
+    if (year < 0 || end - p < 19 || p[4] != '-' || p[7] != '-' || (p[10] != 'T' && p[10] != ' ')
+        || p[13] != ':' || p[16] != ':')
+    {
+        return -1;
+    }
+    int month = ReadFixedDigits(p + 5, end, 2);
+    int day = ReadFixedDigits(p + 8, end, 2);
+    int hour = ReadFixedDigits(p + 11, end, 2);
+    int minute = ReadFixedDigits(p + 14, end, 2);
+    int second = ReadFixedDigits(p + 17, end, 2);
+    if ((month | day | hour | minute | second) < 0 || month < 1 || month > 12 || day < 1 || day > 31)
+    {
+        return -1;
+    }
+    p += 19;
+    // 小数秒：直接忽略
+    if (p < end && (*p == '.' || *p == ','))
+    {
+        size_t n = SkipDigits(p + 1, end);
+        if (n == 0)    return -1;
+        p += 1 + n;
+    }
+    // 时区
+    long long offset = 0;
+    if (p < end && *p == 'Z')
+    {
+        p++;
+    }
+    else if (p < end && (*p == '+' || *p == '-'))
+    {
+        int sign = (*p == '-') ? -1 : 1;
+        int tzHour = ReadFixedDigits(p + 1, end, 2);
+        if (tzHour < 0)    return -1;
+        p += 3;
+        if (p < end && *p == ':')    p++;
+        int tzMinute = ReadFixedDigits(p, end, 2);
+        if (tzMinute < 0)    return -1;
+        p += 2;
+        offset = sign * (tzHour * 3600LL + tzMinute * 60LL);
+    }
+    if (p != end)    return -1;
+    long long seconds = DaysFromCivil(year, (unsigned)month, (unsigned)day) * 86400LL
+        + hour * 3600LL + minute * 60LL + second - offset;
+    // 早于 Unix 纪元的时间会与错误值 -1 混淆（1969-12-31T23:59:59Z 恰为 -1），一律拒绝
+    return seconds >= 0 ? seconds : -1;
+}
+
+/**
+ * 解析带方括号的时间戳
+ * @param data 指向 '[' 的指针
+ * @param len 包含两侧方括号的长度
+ * @return 秒数；格式错误返回 -1
+ */
+inline long long ParseTimestamp(const char *data, size_t len)
+{
+    if (len < 3 || data[0] != '[' || data[len - 1] != ']')    return -1;
+    const char *p = data + 1;
+    const char *end = data + len - 1;
+
+    long long first;
+    size_t n = ReadDigits(p, end, first);
+    if (n == 0)    return -1;
+    p += n;
+
+    // 纯数字：Unix 秒或毫秒
+    if (p == end)    return n >= 12 ? first / 1000 : first;
+
+    // ISO-8601：四位年份后紧跟 '-'
+    if (*p == '-')    return n == 4 ? ParseIso8601(data + 1, end) : -1;
+
+    // H:MM:SS
+    long long minutes, seconds;
+    if (*p != ':')    return -1;
+    p++;
+    n = ReadDigits(p, end, minutes);
+    if (n == 0 || p + n >= end || p[n] != ':')    return -1;
+    p += n + 1;
+    n = ReadDigits(p, end, seconds);
+    if (n == 0 || p + n != end)    return -1;
+    if (first > MAX_CLOCK_FIELD || minutes > MAX_CLOCK_FIELD || seconds > MAX_CLOCK_FIELD)    return -1;
+    return first * 3600 + minutes * 60 + seconds;
+}
+
+/**
+ * 解析查询命令中不带方括号的时间：除上述格式外还接受 H:MM（秒数为 0）
+ * @return 秒数；格式错误返回 -1
+ */
+inline long long ParseQueryTime(const char *data, size_t len)
+{
+    char buffer[64];
+    if (len == 0 || len + 5 > sizeof(buffer))    return -1;
+    size_t colons = 0;
+    bool date = false;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (data[i] == ':')    colons++;
+        if (data[i] == '-')    date = true;
+    }
+    size_t n = 0;
+    buffer[n++] = '[';
+    for (size_t i = 0; i < len; i++)    buffer[n++] = data[i];
+    if (colons == 1 && !date)
+    {
+        buffer[n++] = ':';
+        buffer[n++] = '0';
+        buffer[n++] = '0';
+    }
+    buffer[n++] = ']';
+    return ParseTimestamp(buffer, n);
+}
+
+#endif // TIMESTAMP_PARSER_CPP
@@ -0,0 +1,150 @@
+#ifndef TOPK_SNAPSHOT_CPP
+#define TOPK_SNAPSHOT_CPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// 快照中的一项：保存词本身，读者不需要访问（非线程安全的）符号表
+class snapshotEntry
+{
+public:
+    string word;
+    int count;
+    int error;
+};
+
+// 不可变的 Top-K 快照：发布后不再修改
+class topKSnapshot
+{
+public:
+    vector<snapshotEntry> entries; // 按计数从大到小
+    string asOf;                   // 发布时最后一个句子的时间戳字符串
+    long long sentences = 0;       // 发布时已处理的句子数
+};
+
+/**
+ * Top-K 快照发布器：写者（计数阶段）生成新快照后用一次原子指针交换发布，
+ * 任意数量的读者线程无锁地读取当前快照，写者和读者都不会阻塞对方
+ *
+ * 旧快照用 epoch 方式回收：读者在读取指针前在自己的槽位中登记当前 epoch，读完后清除；
+ * 写者换下旧快照时把它连同当时的 epoch 放入待回收列表，只有所有登记中的读者的 epoch
+ * 都大于它时才释放。读者持有快照期间它不会被释放，读者数超过槽位数时 acquire 返回 nullptr
+ */
+class snapshotPublisher
+{
+private:
+    enum { READER_SLOTS = 64 };
+
+    atomic<const topKSnapshot *> current{nullptr};
+    atomic<uint64_t> epoch{1};
+    atomic<uint64_t> slots[READER_SLOTS]; // 0 表示空闲，否则为登记的 epoch
+    atomic<bool> taken[READER_SLOTS];
+
+    // 待回收的旧快照（只由写者访问）
+    vector<pair<const topKSnapshot *, uint64_t>> retired;
+
+    // 释放所有登记中的读者都不可能再持有的旧快照
+    void reclaim()
+    {
+        uint64_t oldest = UINT64_MAX;
+        for (int i = 0; i < READER_SLOTS; i++)
+        {
+            uint64_t e = slots[i].load(memory_order_seq_cst);
+            if (e != 0 && e < oldest)    oldest = e;
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); i++)
+        {
+            if (retired[i].second < oldest)    delete retired[i].first;
+            else    retired[kept++] = retired[i];
+        }
+        retired.resize(kept);
+    }
+
+public:
+    // 读者持有的快照：析构时解除登记
+    class reader
+    {
+    private:
+        snapshotPublisher *owner;
+        int slot;
+        const topKSnapshot *snapshot;
+
+    public:
+        reader(snapshotPublisher *owner, int slot, const topKSnapshot *snapshot)
+            : owner(owner), slot(slot), snapshot(snapshot) {}
+        reader(reader &&other) : owner(other.owner), slot(other.slot), snapshot(other.snapshot)
+        {
+            other.owner = nullptr;
+        }
+        reader(const reader &) = delete;
+        reader &operator=(const reader &) = delete;
+
+        // 当前快照，尚未发布或槽位已满时为 nullptr
+        const topKSnapshot *get() const
+        {
+            return snapshot;
+        }
+
+        ~reader()
+        {
+            if (owner != nullptr && slot >= 0)
+            {
+                owner->slots[slot].store(0, memory_order_release);
+                owner->taken[slot].store(false, memory_order_release);
+            }
+        }
+    };
+
+    snapshotPublisher()
+    {
+        for (int i = 0; i < READER_SLOTS; i++)
+        {
+            slots[i].store(0);
+            taken[i].store(false);
+        }
+    }
+
+    snapshotPublisher(const snapshotPublisher &) = delete;
+    snapshotPublisher &operator=(const snapshotPublisher &) = delete;
+
+    // 读者：登记 epoch 后读取当前快照，可在任意线程中调用
+    reader acquire()
+    {
+        for (int i = 0; i < READER_SLOTS; i++)
+        {
+            bool expected = false;
+            if (taken[i].load(memory_order_relaxed) || !taken[i].compare_exchange_strong(expected, true))    continue;
+            slots[i].store(epoch.load(memory_order_seq_cst), memory_order_seq_cst);
+            return reader(this, i, current.load(memory_order_seq_cst));
+        }
+        return reader(this, -1, nullptr);
+    }
+
+    // 写者：发布新快照（取得其所有权），换下的旧快照在没有读者持有后释放
+    void publish(const topKSnapshot *snapshot)
+    {
+        const topKSnapshot *old = current.exchange(snapshot, memory_order_seq_cst);
+        if (old != nullptr)    retired.push_back(make_pair(old, epoch.fetch_add(1, memory_order_seq_cst)));
+        reclaim();
+    }
+
+    // 等待回收的旧快照数
+    size_t retiredCount() const
+    {
+        return retired.size();
+    }
+
+    ~snapshotPublisher()
+    {
+        // 此时不应再有读者
+        for (auto &entry : retired)    delete entry.first;
+        delete current.load();
+    }
+};
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef TREND_TRACKER_CPP
+#define TREND_TRACKER_CPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// 趋势查询结果中的一项
+class trendEntry
+{
+public:
+    uint32_t id;
+    double slope; // 每桶的次数变化
+    double level; // 平滑后的每桶次数
+};
+
+/**
+ * 词的变化趋势：按 bucketSeconds 把每个词的出现次数分桶，对每桶次数维护快、慢两个 EWMA
+ * 次数以每桶 r 的速度线性变化时，EWMA 落后真实值 r * (1 - a) / a，
+ * 因此 (快 EWMA - 慢 EWMA) / (慢的滞后系数 - 快的滞后系数) 即为平滑后的斜率（每桶的变化量）
+ *
+ * 每个词只保存最近一个有出现的桶及其次数，桶结束后才并入 EWMA；中间没有出现的桶
+ * 按 (1 - a)^间隔 一次性衰减，因此每次出现 O(1)，查询时才把所有词推进到当前时间
+ * 时间戳早于词最近的桶的出现并入该桶；查询只使用已结束的桶，正在进行的桶不计入
+ */
+class trendTracker
+{
+private:
+    struct wordTrend
+    {
+        long long bucket = 0; // 最近一个有出现的桶
+        int pending = 0;      // 该桶内的次数（尚未并入 EWMA），0 表示词还没有出现过
+        float fast = 0;       // 截至 bucket - 1 的 EWMA
+        float slow = 0;
+    };
+
+    long long bucketSeconds;
+    double fastAlpha, slowAlpha;
+    double slopeScale; // 1 / (慢的滞后系数 - 快的滞后系数)
+    vector<wordTrend> words;
+    long long current = 0; // 见过的最晚的桶
+    bool started = false;
+
+    long long bucketOf(long long timestamp) const
+    {
+        return timestamp >= 0 ? timestamp / bucketSeconds : -((-timestamp + bucketSeconds - 1) / bucketSeconds);
+    }
+
+    // 把 t 推进到桶 target - 1 结束时（target > t.bucket），得到快、慢 EWMA
+    void settle(const wordTrend &t, long long target, double &fast, double &slow) const
+    {
+        fast = t.fast * (1 - fastAlpha) + fastAlpha * t.pending;
+        slow = t.slow * (1 - slowAlpha) + slowAlpha * t.pending;
+        long long gap = target - 1 - t.bucket;
+        if (gap > 0)
+        {
+            fast *= pow(1 - fastAlpha, (double)gap);
+            slow *= pow(1 - slowAlpha, (double)gap);
+        }
+    }
+
+public:
+    /**
+     * @param bucketSeconds 分桶粒度（秒）
+     * @param span 快 EWMA 的跨度（桶），a = 2 / (span + 1)；慢 EWMA 的跨度为其 4 倍
+     */
+    trendTracker(long long bucketSeconds, int span = 5)
+        : bucketSeconds(bucketSeconds > 0 ? bucketSeconds : 1)
+    {
+        if (span < 1)    span = 1;
+        fastAlpha = 2.0 / (span + 1);
+        slowAlpha = 2.0 / (4 * span + 1);
+        slopeScale = 1.0 / ((1 - slowAlpha) / slowAlpha - (1 - fastAlpha) / fastAlpha);
+    }
+
+    // 保存到检查点
+    template <class Writer>
+    void save(Writer &writer) const
+    {
+        writer.put(bucketSeconds);
+        writer.put(current);
+        writer.put(started);
+        writer.putVector(words);
+    }
+
+    // 从检查点恢复，分桶粒度不同时返回 false
+    template <class Reader>
+    bool load(Reader &reader)
+    {
+        long long seconds;
+        if (!reader.get(seconds) || seconds != bucketSeconds)    return false;
+        return reader.get(current) && reader.get(started) && reader.getVector(words);
+    }
+
+    long long bucketLength() const
+    {
+        return bucketSeconds;
+    }
+
+    // 对趋势还不可忽略（推进到当前桶后快、慢 EWMA 至少有一个不小于 0.01）的词调用 f，用于编号回收
+    template <class F>
+    void forEachActive(F &&f) const
+    {
+        for (uint32_t id = 0; id < words.size(); id++)
+        {
+            const wordTrend &t = words[id];
+            if (t.pending == 0)    continue;
+            double fast = t.fast, slow = t.slow;
+            if (t.bucket < current)    settle(t, current, fast, slow);
+            if (t.bucket >= current || fast >= 0.01 || slow >= 0.01)    f(id);
+        }
+    }
+
+    // 编号被回收：丢弃词的状态，复用该编号的新词从头开始
+    void forget(uint32_t id)
+    {
+        if (id < words.size())    words[id] = wordTrend();
+    }
+
+    // 记录一次出现，O(1)
+    void add(uint32_t id, long long timestamp)
+    {
+        long long b = bucketOf(timestamp);
+        if (!started || b > current)
+        {
+            current = b;
+            started = true;
+        }
+        if (id >= words.size())    words.resize(id + 1);
+        wordTrend &t = words[id];
+        if (t.pending == 0)
+        {
+            t.bucket = b;
+            t.pending = 1;
+            return;
+        }
+        if (b <= t.bucket)
+        {
+            t.pending++;
+            return;
+        }
+        double fast, slow;
+        settle(t, b, fast, slow);
+        t.fast = (float)fast;
+        t.slow = (float)slow;
+        t.bucket = b;
+        t.pending = 1;
+    }
+
+    /**
+     * 以最近结束的桶为准，取斜率最大（上升最快）和最小（下降最快）的各 k 个词，O(词表大小)
+     * 斜率为每桶的次数变化，水平为快 EWMA（平滑后的每桶次数）
+     */
+    void query(size_t k, vector<trendEntry> &rising, vector<trendEntry> &falling) const
+    {
+        vector<trendEntry> all;
+        for (uint32_t id = 0; id < words.size(); id++)
+        {
+            const wordTrend &t = words[id];
+            if (t.pending == 0)    continue;
+            double fast = t.fast, slow = t.slow;
+            if (t.bucket < current)    settle(t, current, fast, slow);
+            all.push_back(trendEntry{id, (fast - slow) * slopeScale, fast});
+        }
+        size_t n = min(k, all.size());
+        rising.clear();
+        falling.clear();
+        partial_sort(all.begin(), all.begin() + n, all.end(),
+            [](const trendEntry &a, const trendEntry &b) { return a.slope > b.slope; });
+        for (size_t i = 0; i < n && all[i].slope > 0; i++)    rising.push_back(all[i]);
+        partial_sort(all.begin(), all.begin() + n, all.end(),
+            [](const trendEntry &a, const trendEntry &b) { return a.slope < b.slope; });
+        for (size_t i = 0; i < n && all[i].slope < 0; i++)    falling.push_back(all[i]);
+    }
+};
+
+#endif